@@ -0,0 +1,211 @@
+/**
+ * @file bench.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This program times each phase of assembling a
+ * set of sources through libhackasm, and prints the results as one JSON object
+ * per source (JSON Lines), for tracking regressions over time.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool, true, false
+#include <stdio.h>   // for printf, fprintf, stderr, stdout, FILE, fopen
+#include <stdlib.h>  // for EXIT_FAILURE, EXIT_SUCCESS, malloc, free
+#include <string.h>  // for strcmp, memchr
+
+#include <sys/resource.h> // for getrusage, rusage, RUSAGE_SELF
+
+#include "cli.h"
+#include "hackasm.h"
+#include "pool.h"
+#include "scan.h"
+
+/* the timings of a single run through a source */
+typedef struct run {
+    hackasm_times times;
+    double write; /* rendering the program and writing it out */
+    double total;
+} run;
+
+/* assembles the source once, writing the program to out_path */
+static bool bench_once(const char* const src, const size_t len,
+                       const hackasm_opts* const opts,
+                       const char* const out_path, run* const r,
+                       size_t* const nwords) {
+    hackasm_result result;
+    bool ok = false;
+
+    const double start = hackasm_now();
+
+    if (!hackasm_assemble(src, len, opts, &result)) {
+        goto EXIT;
+    }
+
+    const double write_start = hackasm_now();
+
+    size_t out_len = 0;
+    char* out = hackasm_render(&result, HACKASM_TEXT, opts, &out_len);
+    FILE* fout = fopen(out_path, "w");
+
+    if (out && fout) {
+        ok = (fwrite(out, 1, out_len, fout) == out_len);
+    }
+
+    if (fout) {
+        ok &= !fclose(fout);
+    }
+    free(out);
+
+    r->write = hackasm_now() - write_start;
+    r->times = result.times;
+    r->total = hackasm_now() - start;
+    *nwords = result.nwords;
+
+EXIT:
+    hackasm_result_free(&result);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int EXIT_STATUS = EXIT_SUCCESS;
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * OPTIONS
+     * -r <n>     runs per source, the fastest of which is reported (def. 5)
+     * -j <n>     assemble on n threads (0 for one per processor)
+     * -O <n>     optimization level
+     * -o <path>  where to write the assembled program (def. /dev/null)
+     * -s <isa>   scan for lines with avx2, sse2 or scalar (def. the widest
+     *            the processor supports)
+     * -u         no ROM size limit, for sources bigger than the Hack ROM
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    unsigned long nreps = 5;
+    unsigned long nthreads = 1;
+    hackasm_opts opts = {NULL, 0, false};
+    const char* out_path = "/dev/null";
+    int first = 1;
+
+    for (; first < argc && argv[first][0] == '-'; first += 2) {
+        if (!strcmp(argv[first], "-u")) {
+            opts.no_rom_limit = true;
+            --first; /* takes no value */
+            continue;
+        }
+
+        if (first + 1 >= argc) {
+            break;
+        }
+
+        const char* const val = argv[first + 1];
+
+        if (!strcmp(argv[first], "-r")) {
+            nreps = strtoul(val, NULL, 10);
+        } else if (!strcmp(argv[first], "-j")) {
+            nthreads = strtoul(val, NULL, 10);
+            if (!nthreads) {
+                nthreads = pool_ncpus();
+            }
+        } else if (!strcmp(argv[first], "-O")) {
+            opts.optimize = (unsigned)strtoul(val, NULL, 10);
+        } else if (!strcmp(argv[first], "-o")) {
+            out_path = val;
+        } else if (!strcmp(argv[first], "-s")) {
+            if (!scan_use(val)) {
+                fprintf(stderr, "[ERROR] Can't scan with \"%s\" here\n",
+                        val);
+                return EXIT_FAILURE;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (first >= argc || !nreps) {
+        fprintf(stderr,
+                "[ERROR] Usage: %s [-r <runs>] [-j <threads>] [-O <level>] "
+                "[-o <output>] [-s <isa>] [-u] <path to file>.asm...\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    opts.pool = pool_alloc(nthreads);
+    if (!opts.pool) {
+        fprintf(stderr, "[ERROR] Failed to start worker threads\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = first; i < argc; ++i) {
+        const char* const path = argv[i];
+
+        const double read_start = hackasm_now();
+        size_t len = 0;
+        char* src = cli_slurp(path, &len);
+        const double read = hackasm_now() - read_start;
+
+        if (!src) {
+            fprintf(stderr, "[ERROR] Failed to read source file \"%s\"\n",
+                    path);
+            EXIT_STATUS = EXIT_FAILURE;
+            continue;
+        }
+
+        size_t nlines = 0;
+        for (const char* p = src;
+             (p = memchr(p, '\n', len - (size_t)(p - src))); ++p) {
+            ++nlines;
+        }
+
+        run best = {{0, 0, 0, 0}, 0, 0};
+        size_t nwords = 0;
+        bool ok = true;
+
+        for (unsigned long rep = 0; ok && rep < nreps; ++rep) {
+            run r;
+            ok = bench_once(src, len, &opts, out_path, &r, &nwords);
+
+            if (ok && (!rep || r.total < best.total)) {
+                best = r;
+            }
+        }
+
+        free(src);
+
+        if (!ok) {
+            fprintf(stderr, "[ERROR] Failed to assemble \"%s\"\n", path);
+            EXIT_STATUS = EXIT_FAILURE;
+            continue;
+        }
+
+        /* peak for the whole process so far - run one source per process to
+         * get the peak for each */
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        printf("{\"input\": ");
+        cli_put_json_str(stdout, path);
+        printf(", \"bytes\": %zu, \"lines\": %zu, \"instructions\": %zu, "
+               "\"runs\": %lu, \"threads\": %zu, \"optimize\": %u, "
+               "\"scan\": \"%s\", "
+               "\"read_s\": %.6f, \"parse_s\": %.6f, \"optimize_s\": %.6f, "
+               "\"resolve_s\": %.6f, \"encode_s\": %.6f, \"write_s\": %.6f, "
+               "\"total_s\": %.6f, \"lines_per_s\": %.0f, "
+               "\"mib_per_s\": %.2f, \"peak_rss_kib\": %ld}\n",
+               len, nlines, nwords, nreps, pool_size(opts.pool), opts.optimize,
+               scan_impl(),
+               read, best.times.parse, best.times.optimize,
+               best.times.resolve, best.times.encode, best.write, best.total,
+               (double)nlines / best.total,
+               (double)len / (1 << 20) / best.total, usage.ru_maxrss);
+        fflush(stdout);
+    }
+
+    pool_free(opts.pool);
+
+    return EXIT_STATUS;
+}
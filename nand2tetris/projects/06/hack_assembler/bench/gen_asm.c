@@ -0,0 +1,107 @@
+/**
+ * @file gen_asm.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This program generates synthetic Hack assembly
+ * for benchmarking, with roughly the mix of labels, variables, comments and
+ * C-instructions found in the output of the VM translator.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <inttypes.h> // for PRIu64
+#include <stdint.h>   // for uint64_t
+#include <stdio.h>    // for printf, fprintf, stderr
+#include <stdlib.h>   // for EXIT_FAILURE, EXIT_SUCCESS, strtoull
+
+static const char* const DESTS[] = {"",    "M=",  "D=",  "A=",
+                                    "AM=", "AD=", "DM=", "ADM="};
+static const char* const COMPS[] = {"0",   "1",   "-1",  "D",   "A",   "M",
+                                    "!D",  "-D",  "D+1", "A-1", "M+1", "D+A",
+                                    "D-M", "D&A", "D|M", "A-D", "M-D"};
+static const char* const JUMPS[] = {"",     "",     ";JGT", ";JEQ", ";JLT",
+                                    ";JNE", ";JMP", ";JLE", ";JGE"};
+static const char* const BUILTINS[] = {"SP",  "LCL", "ARG", "THIS",   "THAT",
+                                       "R13", "R14", "R15", "SCREEN", "KBD"};
+
+#define COUNT(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+/* number of distinct classes (and so of static variable prefixes) */
+static const uint64_t NCLASSES = 50;
+
+/* xorshift64* [https://doi.org/10.18637/jss.v008.i14] */
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1Du;
+}
+
+/* uniform in [0, n) (near enough) */
+static uint64_t rng_below(const uint64_t n) {
+    return rng() % n;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "[ERROR] Usage: %s <number of lines> [seed]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const uint64_t nlines = strtoull(argv[1], NULL, 10);
+    if (argc == 3) {
+        rng_state ^= strtoull(argv[2], NULL, 10);
+    }
+
+    /* labels are all either a function or one of its return sites, so any
+     * label defined so far can be named by its (function, return) numbers */
+    uint64_t nfuncs = 0, nrets = 0;
+
+    for (uint64_t i = 0; i < nlines; ++i) {
+        const uint64_t r = rng_below(100);
+
+        if (r < 1) {
+            ++nfuncs;
+            printf("(Class%" PRIu64 ".func%" PRIu64 ")\n", nfuncs % NCLASSES,
+                   nfuncs);
+        } else if (r < 5) {
+            ++nrets;
+            printf("(Class%" PRIu64 ".func%" PRIu64 "$ret.%" PRIu64 ")\n",
+                   nfuncs % NCLASSES, nfuncs, nrets);
+        } else if (r < 10) {
+            printf("// comment line %" PRIu64 "\n", i);
+        } else if (r < 12) {
+            printf("\n");
+        } else if (r < 30) {
+            if (nfuncs && rng_below(10) < 6) {
+                /* jump to a function defined earlier */
+                const uint64_t f = 1 + rng_below(nfuncs);
+                printf("@Class%" PRIu64 ".func%" PRIu64 "\n", f % NCLASSES, f);
+            } else {
+                printf("@Class%" PRIu64 ".static%" PRIu64 "\n",
+                       rng_below(NCLASSES), rng_below(8));
+            }
+        } else if (r < 45) {
+            printf("@%" PRIu64 "\n", rng_below(32768));
+        } else if (r < 50) {
+            printf("@%s\n", BUILTINS[rng_below(COUNT(BUILTINS))]);
+        } else {
+            const char* dest = DESTS[rng_below(COUNT(DESTS))];
+            const char* jump = JUMPS[rng_below(COUNT(JUMPS))];
+            if (!*dest && !*jump) {
+                dest = "D=";
+            }
+            printf("    %s%s%s\n", dest, COMPS[rng_below(COUNT(COMPS))],
+                   jump);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
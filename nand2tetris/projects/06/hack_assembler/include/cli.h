@@ -0,0 +1,51 @@
+/**
+ * @file cli.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module holds what the programs built on
+ * libhackasm (the assembler, the linker and the benchmarks) have in common:
+ * reading their inputs and reporting on the results.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#ifndef HACK_ASSEMBLER_CLI_H
+#define HACK_ASSEMBLER_CLI_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h> // for size_t
+#include <stdio.h>  // for FILE
+
+#include "hackasm.h"
+
+/**
+ * @brief Reads a whole file into memory.
+ *
+ * @param[in] path the file to read
+ * @param[out] len length of the file in bytes
+ * @return heap-allocated contents of the file, NULL if it couldn't be read
+ */
+char* cli_slurp(const char* const path, size_t* const len);
+
+/**
+ * @brief Reports on stderr what takes up the space in a program too large for
+ * ROM: its size, then the largest functions.
+ *
+ * @param[in] result a result whose assembly or link failed with
+ * HACKASM_ROM_SIZE
+ */
+void cli_print_funcs(const hackasm_result* const result);
+
+/**
+ * @brief Writes a string to a stream as a JSON string literal, escaping
+ * quotes, backslashes and control characters.
+ *
+ * @param[in,out] f the stream to write to
+ * @param[in] s the NUL-terminated string to write
+ */
+void cli_put_json_str(FILE* const f, const char* s);
+
+#endif // HACK_ASSEMBLER_CLI_H
@@ -0,0 +1,222 @@
+/**
+ * @file hackasm.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module is the public face of libhackasm: it
+ * assembles a Hack program held in memory into machine words (or into objects,
+ * then links those), without touching the filesystem, and reports the symbols
+ * it defined and any errors it found.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#ifndef HACK_ASSEMBLER_HACKASM_H
+#define HACK_ASSEMBLER_HACKASM_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint16_t, uint32_t
+
+#include "pool.h"
+
+/* words of ROM on the Hack computer, and so the longest program it can run */
+#define HACKASM_ROM_WORDS 32768
+
+/* what went wrong with a program */
+typedef enum hackasm_diag_kind {
+    HACKASM_SYNTAX,    /* a line is not a valid instruction */
+    HACKASM_ENCODING,  /* an instruction has no machine encoding */
+    HACKASM_REFERENCE, /* a symbol could not be resolved */
+    HACKASM_ROM_SIZE,  /* the program does not fit in ROM */
+    HACKASM_SRC_SIZE,  /* the source is 4 GiB or more, too large to address */
+    HACKASM_CORRUPT,   /* an object file is corrupt (linking only) */
+    HACKASM_RESOURCES  /* ran out of memory */
+} hackasm_diag_kind;
+
+typedef struct hackasm_diag {
+    hackasm_diag_kind kind;
+    /* line number in the source, 0 if not tied to a line; when linking, the
+     * index of the object instead */
+    uint32_t line;
+
+    /* the offending line (syntax) or symbol (reference), pointing into the
+     * source buffer; NULL if there is nothing to show */
+    const char* text;
+    size_t len;
+} hackasm_diag;
+
+typedef enum hackasm_sym_kind {
+    HACKASM_LABEL,   /* address is a ROM address */
+    HACKASM_VARIABLE /* address is a RAM address */
+} hackasm_sym_kind;
+
+/* a symbol defined by the program (predefined symbols are not included) */
+typedef struct hackasm_symbol {
+    hackasm_sym_kind kind;
+    const char* name; /* points into the source buffer, not NUL-terminated */
+    size_t len;
+    uint16_t address;
+} hackasm_symbol;
+
+/* an A-instruction left for the linker, in relocatable results */
+typedef struct hackasm_ref {
+    size_t word;      /* index of the A-instruction in the program */
+    const char* name; /* the symbol, pointing into the source buffer */
+    size_t len;
+} hackasm_ref;
+
+/* the ROM taken up by one function: everything from a label without a '$' in
+ * it (which is how the VM translator names functions) up to the next one */
+typedef struct hackasm_func {
+    const char* name; /* points into the source, NULL for code before the
+                         first such label */
+    size_t len;
+    size_t address; /* where the function starts in the (too large) ROM */
+    size_t nwords;
+} hackasm_func;
+
+typedef struct hackasm_opts {
+    thread_pool* pool; /* threads to split the source across, or NULL */
+    /* 0 for none, 1 for peephole, 2 for dead code too (see optimizer.h) */
+    unsigned optimize;
+    /* let programs grow past HACKASM_ROM_WORDS, for benchmarking huge
+     * sources; label addresses wrap around, so the result won't run */
+    bool no_rom_limit;
+    /* leave every reference to a label or variable for hackasm_link, to
+     * render as an object; code may be reached from other objects, so only
+     * peephole optimization applies */
+    bool relocatable;
+    /* keep the source line of every machine word, for HACKASM_SYMBOLS */
+    bool record_lines;
+} hackasm_opts;
+
+/* wall-clock time spent in each phase of hackasm_assemble, in seconds */
+typedef struct hackasm_times {
+    double parse;    /* splitting the source into lines and parsing them */
+    double optimize; /* rewriting the program, if asked to */
+    double resolve;  /* defining labels and numbering variables */
+    double encode;   /* looking up symbols, encoding machine words */
+} hackasm_times;
+
+/* seconds since some fixed point in the past, on the clock hackasm_times are
+ * measured with, so callers can time their own work alongside */
+double hackasm_now(void);
+
+/* what hackasm_assemble got through, and what it took to get there */
+typedef struct hackasm_stats {
+    size_t nlines;  /* lines of source */
+    size_t ninstrs; /* A- and C-instructions parsed, before optimizing */
+    size_t nlabels; /* label definitions parsed, before optimizing */
+    size_t nvars;   /* variables given a RAM address */
+
+    /* the symbol table, predefined symbols included */
+    size_t tbl_len;           /* symbols */
+    size_t tbl_cap;           /* slots */
+    size_t tbl_longest_probe; /* most slots looked at to find any one symbol */
+
+    /* heap blocks allocated or resized, the optimizer's scratch space and
+     * rendering aside */
+    size_t nallocs;
+} hackasm_stats;
+
+typedef struct hackasm_result {
+    uint16_t* rom; /* the encoded program, one machine word per instruction */
+    size_t nwords;
+    /* the source line of each word, if record_lines was set; NULL otherwise */
+    uint32_t* lines;
+
+    /* labels in source order, then variables in order of first use */
+    hackasm_symbol* symbols;
+    size_t nsymbols;
+
+    /* relocatable results only: references to labels and variables, in
+     * program order (these words are left 0, and there are no variables) */
+    hackasm_ref* refs;
+    size_t nrefs;
+
+    hackasm_diag* diags;
+    size_t ndiags;
+
+    /* when the program doesn't fit in ROM, what takes up the space, largest
+     * first; empty otherwise */
+    hackasm_func* funcs;
+    size_t nfuncs;
+
+    /* both filled in as far as assembly got */
+    hackasm_times times;
+    hackasm_stats stats;
+} hackasm_result;
+
+/* output formats for hackasm_render */
+typedef enum hackasm_format {
+    HACKASM_TEXT,   /* .hack: 16 binary digits per line */
+    HACKASM_ROM,    /* .rom: binary image, see translator.h */
+    HACKASM_OBJECT, /* .hobj: relocatable object, see object.h */
+    HACKASM_SYMBOLS /* .sym: symbol map, see symmap.h */
+} hackasm_format;
+
+/* the file extension a format is written with, ".hack" for HACKASM_TEXT */
+const char* hackasm_format_ext(const hackasm_format format);
+
+/**
+ * @brief Assembles a Hack program held in memory. The result refers back into
+ * the source buffer, so it must outlive the result.
+ *
+ * @param[in] src the assembly source (need not be NUL-terminated)
+ * @param[in] len length of the source in bytes
+ * @param[in] opts assembly settings, or NULL for the defaults
+ * @param[out] result the encoded program, its symbols and diagnostics; must be
+ * released with hackasm_result_free, whether or not assembly succeeded
+ * @return program was/was not assembled without errors
+ */
+bool hackasm_assemble(const char* const src, const size_t len,
+                      const hackasm_opts* const opts,
+                      hackasm_result* const result);
+
+/**
+ * @brief Frees everything a result owns and resets it to empty.
+ *
+ * @param[in,out] result a result filled in by hackasm_assemble
+ */
+void hackasm_result_free(hackasm_result* const result);
+
+/**
+ * @brief Links objects into a whole program, as if their sources had been
+ * assembled together in the same order: the first definition of a label
+ * counts, and anything that isn't a label anywhere becomes a variable,
+ * numbered in order of first use.
+ *
+ * @param[in] objs the object files (see object.h), in link order
+ * @param[in] lens length of each object file in bytes
+ * @param[in] nobjs number of objects
+ * @param[in] opts link settings, or NULL for the defaults (only no_rom_limit
+ * applies)
+ * @param[out] result the linked program and its symbols, which point into the
+ * object buffers, so they must outlive the result; must be released with
+ * hackasm_result_free, whether or not linking succeeded
+ * @return objects were/were not linked without errors
+ */
+bool hackasm_link(const char* const* const objs, const size_t* const lens,
+                  const size_t nobjs, const hackasm_opts* const opts,
+                  hackasm_result* const result);
+
+/**
+ * @brief Renders an assembled program in one of the output formats.
+ *
+ * @param[in] result a result successfully filled in by hackasm_assemble (with
+ * relocatable set for HACKASM_OBJECT, and record_lines for the line table of
+ * HACKASM_SYMBOLS) or by hackasm_link
+ * @param[in] format the output format
+ * @param[in] opts render settings, or NULL for the defaults
+ * @param[out] len length of the rendered output in bytes
+ * @return heap-allocated rendered output, NULL on failure
+ */
+char* hackasm_render(const hackasm_result* const result,
+                     const hackasm_format format,
+                     const hackasm_opts* const opts, size_t* const len);
+
+#endif // HACK_ASSEMBLER_HACKASM_H
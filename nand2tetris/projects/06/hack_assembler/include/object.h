@@ -0,0 +1,111 @@
+/**
+ * @file object.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module writes and reads relocatable object
+ * files: one piece of a program, assembled on its own, with every reference
+ * to a label or variable left for the linker to fill in.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#ifndef HACK_ASSEMBLER_OBJECT_H
+#define HACK_ASSEMBLER_OBJECT_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint16_t
+
+#include "hackasm.h"
+
+/*
+ * Object files are a fixed 32-byte header followed by four tables:
+ *
+ *   offset  size  contents
+ *        0     4  magic number "HOBJ"
+ *        4     2  format version (OBJ_VERSION)
+ *        6     2  length of the header in bytes (OBJ_HEADER_LEN)
+ *        8     4  number of machine words, n
+ *       12     4  number of labels defined, l
+ *       16     4  number of symbols referred to, s
+ *       20     4  number of references, r
+ *       24     4  length of the string table in bytes
+ *       28     4  CRC-32 (as for ROM images) of everything after the header
+ *       32   2*n  machine words, 0 wherever a reference goes
+ *            12*l labels: name offset, name length, address (from word 0)
+ *             8*s symbols: name offset, name length
+ *             8*r references: index of the word, index of the symbol
+ *                 string table: names back to back, not NUL-terminated
+ *
+ * All multi-byte fields are little-endian; names are offsets into the string
+ * table. References come in the order of the words they fill in, so that
+ * linking numbers variables in the same order assembling the whole program
+ * at once would.
+ */
+#define OBJ_MAGIC "HOBJ"
+#define OBJ_VERSION 1
+#define OBJ_HEADER_LEN 32
+
+/* a label an object defines, or a symbol it refers to */
+typedef struct obj_symbol {
+    const char* name; /* points into the object's string table */
+    size_t len;
+    size_t address; /* labels only: the word the label marks */
+} obj_symbol;
+
+/* an A-instruction waiting for the address of a symbol */
+typedef struct obj_ref {
+    size_t word;   /* index of the A-instruction in the object's code */
+    size_t symbol; /* index into the object's symbols */
+} obj_ref;
+
+/* an object file read into memory; names point into the file's buffer */
+typedef struct object {
+    uint16_t* code;
+    size_t ncode;
+
+    obj_symbol* labels;
+    size_t nlabels;
+
+    obj_symbol* symbols;
+    size_t nsymbols;
+
+    obj_ref* refs;
+    size_t nrefs;
+} object;
+
+/**
+ * @brief Renders an assembled (but not linked) program as an object file.
+ *
+ * @param[in] result a result filled in by hackasm_assemble with relocatable
+ * set; variables are ignored, only labels are written out
+ * @param[out] len length of the object file in bytes
+ * @return heap-allocated object file, NULL on failure
+ */
+char* object_render(const hackasm_result* const result, size_t* const len);
+
+/**
+ * @brief Reads and checks an object file held in memory. The object refers
+ * back into the buffer, so it must outlive the object.
+ *
+ * @param[in] data the object file
+ * @param[in] len length of the object file in bytes
+ * @param[out] obj the object's tables; must be released with object_free,
+ * whether or not it could be read
+ * @return file was/was not a well-formed object file (false also when out of
+ * memory)
+ */
+bool object_read(const char* const data, const size_t len, object* const obj);
+
+/**
+ * @brief Frees everything an object owns and resets it to empty.
+ *
+ * @param[in,out] obj an object filled in by object_read
+ */
+void object_free(object* const obj);
+
+#endif // HACK_ASSEMBLER_OBJECT_H
@@ -0,0 +1,71 @@
+/**
+ * @file optimizer.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module rewrites a parsed program, before any
+ * addresses are assigned, into an equivalent one that is smaller and faster.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#ifndef HACK_ASSEMBLER_OPTIMIZER_H
+#define HACK_ASSEMBLER_OPTIMIZER_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool
+
+#include "parser.h"
+
+/**
+ * @brief Runs peephole optimizations over a whole program until none of them
+ * apply any more:
+ *  - loads of the value A already holds are dropped
+ *  - code following an unconditional jump, up to the next label, is dropped
+ *  - jumps to a label that just jumps on elsewhere are sent straight there,
+ *    unless the program is to be linked
+ *
+ * Instructions may only be removed, never added, and every label index is
+ * updated to match. Code is assumed to reach other code only through labels:
+ * programs that jump to a constant or predefined address are left untouched,
+ * since removing anything would move the target. A label whose address is
+ * used in arithmetic, as the base of a jump table, has its code up to the next
+ * label kept exactly as it is; this is only caught when the arithmetic is on
+ * A right after the label is loaded, or on D after the address was copied
+ * there. Variables get numbered later, in order of first use in the optimized
+ * program.
+ *
+ * @param[in,out] prog every A- and C-instruction in the program
+ * @param[in,out] labels every label definition in the program
+ * @param[in] src the source the program was parsed from
+ * @param[in] relocatable the program is an object, whose labels may also be
+ * defined by objects linked before it (the first definition in link order
+ * counts, not necessarily the one seen here)
+ * @return program was/was not optimized (false only when out of memory, in
+ * which case the program is still valid, if not fully optimized)
+ */
+bool optimize_peephole(instr_array* const prog, label_array* const labels,
+                       const char* const src, const bool relocatable);
+
+/**
+ * @brief Removes every instruction that can't be reached from address 0, then
+ * every label definition nothing refers to any more.
+ *
+ * Execution is followed through fall-through and through labels: any label
+ * whose address a reachable instruction loads (to jump there, or to stash it
+ * in D as a return address) counts as reachable. As with optimize_peephole,
+ * programs that jump to constant or predefined addresses are left untouched,
+ * and jump tables are kept whole, all of their code counting as reachable.
+ *
+ * @param[in,out] prog every A- and C-instruction in the program
+ * @param[in,out] labels every label definition in the program
+ * @param[in] src the source the program was parsed from
+ * @return program was/was not optimized (false only when out of memory, in
+ * which case the program is still valid, if not fully optimized)
+ */
+bool optimize_dead_code(instr_array* const prog, label_array* const labels,
+                        const char* const src);
+
+#endif // HACK_ASSEMBLER_OPTIMIZER_H
@@ -18,12 +18,19 @@
 #define _POSIX_C_SOURCE 200809L
 #include <regex.h>   // for regmatch_t, regex_t, regcomp, regerror, regexec
 #include <stdbool.h> // for bool
-#include <stdint.h>  // for uint16_t
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint16_t, uint32_t
 
 #include "sym_tbl.h"
 
 typedef enum { A_INSTR, C_INSTR, L_INSTR, COMMENT_IGNORE } instr_t;
 
+/* a field of an instruction, as an (offset, length) view into the source */
+typedef struct src_span {
+    uint32_t off;
+    uint32_t len;
+} src_span;
+
 typedef struct instruction {
     instr_t type;
 
@@ -33,32 +40,129 @@ typedef struct instruction {
             bool resolved;
             union {
                 uint16_t addr;
-                char* symbol;
+                src_span symbol;
             };
         };
 
         /* C-instuctions */
         struct {
-            char* dest;
-            char* comp;
-            char* jump;
+            src_span dest;
+            src_span comp;
+            src_span jump;
         };
     };
 
-    uint16_t line_number;     /* line number in source file */
-    struct instruction* next; /* next instruction in queue */
+    uint32_t line_number; /* line number in source file */
 } instruction;
 
+/* a label definition: the symbol, and the instruction it refers to */
+typedef struct label_def {
+    src_span symbol;
+    uint32_t idx; /* index of the instruction following the label */
+} label_def;
+
+/* the instruction queue: one contiguous, growable block of instructions */
+typedef struct instr_array {
+    instruction* instrs;
+    size_t len;
+    size_t cap;
+    size_t nallocs; /* times the block was allocated or resized */
+} instr_array;
+
+/* a non-owning view of part of a source line (not NUL-terminated) */
+typedef struct str_view {
+    const char* ptr;
+    size_t len;
+} str_view;
+
+/* the fields of a single source line, as recognized by the scanner */
+typedef struct scanned_instr {
+    instr_t type;
+
+    /* A-instructions with a constant address */
+    bool resolved;
+    uint16_t addr;
+
+    /* symbolic A-instructions and L-instructions */
+    str_view symbol;
+
+    /* C-instructions (fields not present in the source have length 0) */
+    str_view dest;
+    str_view comp;
+    str_view jump;
+} scanned_instr;
+
 /**
- * @brief Parses an instruction (string in source file) into it's constiuent
- * fields.
+ * @brief Classifies a single line of source and extracts its fields in one
+ * pass over the characters, without allocating any memory. All views in the
+ * result point into the line itself.
  *
- * @param[in] line a line from the source file, including endline character(s)
+ * @param[in] line a line from the source file, with or without its endline
+ * character(s)
+ * @param[in] len length of the line in bytes
+ * @param[out] out fields of the recognized instruction
+ * @return line is/is not syntactically valid
+ */
+bool scan_instr(const char* const line, const size_t len,
+                scanned_instr* const out);
+
+/**
+ * @brief Parses an instruction (line in source file) into it's constiuent
+ * fields. The fields of the parsed instruction refer back into the source
+ * buffer, so no memory is allocated and the source must outlive the
+ * instruction.
+ *
+ * @param[in] src the entire source file
+ * @param[in] off offset of the line in the source
+ * @param[in] len length of the line, including endline character(s)
  * @param[in] line_num line of source the instuction appears on
- * @return heap-allocated instuction struct on success, NULL on failure (syntax
- * error)
+ * @param[out] instr the parsed instruction
+ * @return true on success, false on failure (syntax error)
+ */
+bool parse_instr(const char* const src, const size_t off, const size_t len,
+                 const uint32_t line_num, instruction* const instr);
+
+/* label definitions, in the order they appear in the source */
+typedef struct label_array {
+    label_def* labels;
+    size_t len;
+    size_t cap;
+    size_t nallocs; /* times the block was allocated or resized */
+} label_array;
+
+/**
+ * @brief Sets up an empty instruction array.
+ *
+ * @param[out] arr the array to initialize
+ * @param[in] cap_hint expected number of instructions (may be 0)
+ * @return false if out of memory, leaving the array empty but safe to free
+ */
+bool instr_array_init(instr_array* const arr, const size_t cap_hint);
+
+/**
+ * @brief Appends a slot to the back of an instruction array, growing it
+ * geometrically when full.
+ *
+ * @param[in,out] arr the array to append to
+ * @return pointer to the new (uninitialized) slot, NULL if out of memory;
+ * only valid until the next append
  */
-instruction* parse_instr(const char* const line, const uint16_t line_num);
+instruction* instr_array_push(instr_array* const arr);
+
+/**
+ * @brief Releases all instructions in an array at once.
+ *
+ * @param[in,out] arr the array to free
+ */
+void instr_array_free(instr_array* const arr);
+
+/* label arrays work exactly like instruction arrays */
+
+bool label_array_init(label_array* const arr, const size_t cap_hint);
+
+label_def* label_array_push(label_array* const arr);
+
+void label_array_free(label_array* const arr);
 
 /**
  * @brief Attempts to resolve a symbolic reference in an A-instuction to a
@@ -67,13 +171,14 @@ instruction* parse_instr(const char* const line, const uint16_t line_num);
  * updated.
  *
  * @param[in,out] instr an A-instuction with a symbolic reference
+ * @param[in] src the source the instruction was parsed from
  * @param[in,out] tbl the symbol table for the current program
  * @param[in,out] nvars the variable counter; gives number of *next* variable to
  * be seen
  * @return symbolic reference was/was not able to be resolved to an address
  */
-bool resolve_reference(instruction* const instr, sym_tbl* const tbl,
-                       uint16_t* const nvars);
+bool resolve_reference(instruction* const instr, const char* const src,
+                       sym_tbl* const tbl, uint16_t* const nvars);
 
 /**
  * @brief Attempts to match a string to a regular expression using the
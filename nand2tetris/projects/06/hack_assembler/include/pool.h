@@ -0,0 +1,71 @@
+/**
+ * @file pool.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module provides a fixed-size pool of worker
+ * threads, used to run independent pieces of work (chunks of a source file,
+ * whole source files) in parallel.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#ifndef HACK_ASSEMBLER_POOL_H
+#define HACK_ASSEMBLER_POOL_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h> // for size_t
+
+/* a single piece of work: the idx'th of some batch of tasks sharing ctx */
+typedef void (*pool_task)(void* ctx, size_t idx);
+
+typedef struct thread_pool thread_pool;
+
+/**
+ * @brief Starts a pool of worker threads.
+ *
+ * @param[in] nthreads total number of threads to run tasks on, including the
+ * calling thread (so 1 starts no threads at all)
+ * @return heap-allocated pool, NULL on failure
+ */
+thread_pool* pool_alloc(const size_t nthreads);
+
+/**
+ * @brief Stops and joins all workers, then frees the pool.
+ *
+ * @param[in,out] pool a pool previously allocated with pool_alloc
+ */
+void pool_free(thread_pool* const pool);
+
+/**
+ * @brief Runs task(ctx, 0) ... task(ctx, ntasks - 1) across the pool, with
+ * the calling thread helping out, and waits for all of them to finish.
+ * Tasks are handed out in index order, but may complete in any order.
+ *
+ * @param[in,out] pool the pool to run on, or NULL to run every task in order
+ * on the calling thread
+ * @param[in] ntasks number of tasks in the batch
+ * @param[in] task the work to do for each index
+ * @param[in,out] ctx shared state passed to every task
+ */
+void pool_for(thread_pool* const pool, const size_t ntasks, pool_task task,
+              void* const ctx);
+
+/**
+ * @brief Queries the number of threads the pool runs tasks on.
+ *
+ * @param[in] pool the pool to query
+ * @return number of threads, including the calling thread
+ */
+size_t pool_size(const thread_pool* const pool);
+
+/**
+ * @brief Queries the number of processors currently online.
+ *
+ * @return number of processors, at least 1
+ */
+size_t pool_ncpus(void);
+
+#endif // HACK_ASSEMBLER_POOL_H
@@ -0,0 +1,70 @@
+/**
+ * @file scan.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module splits a source into lines a block
+ * at a time: every 64 bytes are turned into a bitmask of endline characters
+ * with vector compares, so finding the next line is a bit scan rather than a
+ * call to memchr per line. The widest instruction set the processor supports
+ * (AVX2, then SSE2, then plain C) is picked the first time it's needed.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#ifndef HACK_ASSEMBLER_SCAN_H
+#define HACK_ASSEMBLER_SCAN_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+/* bytes covered by one bitmask */
+#define SCAN_BLOCK_LEN 64
+
+/* where a scan is up to in a range of the source */
+typedef struct line_scanner {
+    const char* data;
+    size_t end;    /* end of the range being scanned */
+    size_t block;  /* offset of the block the mask covers */
+    uint64_t mask; /* endlines in the block not returned yet, bit i for byte i */
+} line_scanner;
+
+/**
+ * @brief Starts scanning a range of a source for lines.
+ *
+ * @param[out] sc the scanner
+ * @param[in] data the source
+ * @param[in] begin offset of the first byte to scan
+ * @param[in] end offset just past the last byte to scan; nothing at or past
+ * it is ever read
+ */
+void scan_init(line_scanner* const sc, const char* const data,
+               const size_t begin, const size_t end);
+
+/**
+ * @brief Finds the end of the next line.
+ *
+ * @param[in,out] sc the scanner
+ * @return offset just past the next endline character, or the end of the
+ * range if there are no more
+ */
+size_t scan_next(line_scanner* const sc);
+
+/**
+ * @brief Picks the instruction set to scan with, for comparing them; the
+ * default is the widest one the processor supports. Not safe to call while
+ * anything is being scanned.
+ *
+ * @param[in] name "avx2", "sse2" or "scalar"
+ * @return instruction set is/is not supported on this processor
+ */
+bool scan_use(const char* const name);
+
+/* the instruction set scans are done with */
+const char* scan_impl(void);
+
+#endif // HACK_ASSEMBLER_SCAN_H
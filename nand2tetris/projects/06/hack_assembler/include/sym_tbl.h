@@ -17,6 +17,7 @@
 
 #define _POSIX_C_SOURCE 200809L
 #include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
 #include <stdint.h>  // for uint16_t
 
 /* indicates a failed table lookup */
@@ -24,13 +25,34 @@ extern const uint16_t SYM_TBL_NPOS;
 
 typedef struct sym_tbl sym_tbl;
 
+/* how full a table is, and how hard it works to find things */
+typedef struct sym_tbl_stats {
+    size_t len;           /* symbols in the table */
+    size_t cap;           /* slots in the table */
+    size_t longest_probe; /* most slots looked at to find any one symbol */
+    size_t nallocs;       /* heap blocks allocated or resized so far */
+} sym_tbl_stats;
+
+/* every new table starts out holding the predefined symbols; safe to call
+ * from several threads at once. Both allocators return NULL when out of
+ * memory */
 sym_tbl* sym_tbl_alloc();
 
+/* a table without the predefined symbols, for mapping names to anything
+ * other than Hack addresses */
+sym_tbl* sym_tbl_alloc_empty();
+
 void sym_tbl_free(sym_tbl* tbl);
 
+/* symbols are given as (pointer, length) and need not be NUL-terminated */
+
 bool sym_tbl_insert(sym_tbl* const tbl, const char* const sym,
-                    const uint16_t addr);
+                    const size_t len, const uint16_t addr);
+
+uint16_t sym_tbl_lookup(const sym_tbl* const tbl, const char* const sym,
+                        const size_t len);
 
-uint16_t sym_tbl_lookup(const sym_tbl* const tbl, const char* const sym);
+/* walks every slot, so meant for reporting rather than hot paths */
+void sym_tbl_get_stats(const sym_tbl* const tbl, sym_tbl_stats* const stats);
 
 #endif // HACK_ASSEMBLER_SYM_TBL_
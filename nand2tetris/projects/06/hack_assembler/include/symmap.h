@@ -0,0 +1,60 @@
+/**
+ * @file symmap.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module writes symbol maps: where each label
+ * and variable of an assembled program ended up, and which source line each
+ * machine word came from, for profilers and debuggers to look addresses up in.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#ifndef HACK_ASSEMBLER_SYMMAP_H
+#define HACK_ASSEMBLER_SYMMAP_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h> // for size_t
+
+#include "hackasm.h"
+
+/*
+ * Symbol maps are a fixed 32-byte header followed by three tables:
+ *
+ *   offset  size  contents
+ *        0     4  magic number "HSYM"
+ *        4     2  format version (SYM_VERSION)
+ *        6     2  length of the header in bytes (SYM_HEADER_LEN)
+ *        8     4  number of labels, l
+ *       12     4  number of variables, v
+ *       16     4  number of source lines, n (one per machine word, or 0 if
+ *                 they weren't recorded)
+ *       20     4  length of the string table in bytes
+ *       24     4  CRC-32 (as for ROM images) of everything after the header
+ *       28     4  reserved, 0
+ *       32  12*l  labels: ROM address, name offset, name length
+ *           12*v  variables: RAM address, name offset, name length
+ *            4*n  source line of each machine word, indexed by ROM address
+ *                 string table: names back to back, not NUL-terminated
+ *
+ * All multi-byte fields are little-endian. Labels and variables are sorted by
+ * address (then by name), so either can be binary searched: the code at a ROM
+ * address belongs to the last label at or below it.
+ */
+#define SYM_MAGIC "HSYM"
+#define SYM_VERSION 1
+#define SYM_HEADER_LEN 32
+
+/**
+ * @brief Renders the symbols of an assembled program as a symbol map.
+ *
+ * @param[in] result a result filled in by hackasm_assemble (with record_lines
+ * set, for the line table) or by hackasm_link
+ * @param[out] len length of the symbol map in bytes
+ * @return heap-allocated symbol map, NULL on failure
+ */
+char* symmap_render(const hackasm_result* const result, size_t* const len);
+
+#endif // HACK_ASSEMBLER_SYMMAP_H
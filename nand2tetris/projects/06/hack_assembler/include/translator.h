@@ -1,13 +1,14 @@
 /**
- * @file sym_tbl.h
+ * @file translator.h
  * @author Vincent Marias <vmarias@mines.edu>
  * @date 03/05/2024
  *
  * @brief This file is part of the HackAssember program, an assembler for the
  * Hack architecture, as described in "The Elements of Computing Systems", 2nd
  * Ed. by Nisan and Schocken. This module handles translating instruction
- * op-codes and value fields to their binary equivalents in the form of
- * character strings of the ASCII characters '0' and '1'.
+ * op-codes and value fields to their binary equivalents, and rendering the
+ * resulting machine words as character strings of the ASCII characters '0'
+ * and '1'.
  *
  * @copyright Vincent Marias, 2024
  */
@@ -16,14 +17,82 @@
 #define HACK_ASSEMBLER_TRANSLATOR_H
 
 #define _POSIX_C_SOURCE 200809L
-#include <stdint.h> // for uint16_t
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint16_t, uint32_t, UINT16_MAX
 
-char* translate_dest(const char* const dest);
+/* indicates a field that could not be translated */
+extern const uint16_t TRANSLATE_ERR;
 
-char* translate_comp(const char* const comp);
+/* a C-instruction is C_PREFIX | comp | dest | jump */
+#define C_PREFIX ((uint16_t)0xE000)
 
-char* translate_jump(const char* const jump);
+/* length of one rendered instruction: 16 binary digits and an endline */
+#define TRANSLATE_LINE_LEN 17
 
+/* fields are given as (pointer, length) and need not be NUL-terminated; the
+ * returned bits are already shifted into their position in the instruction */
+
+uint16_t translate_dest(const char* const dest, const size_t len);
+
+uint16_t translate_comp(const char* const comp, const size_t len);
+
+uint16_t translate_jump(const char* const jump, const size_t len);
+
+/**
+ * @brief Renders a single machine word as 16 ASCII binary digits.
+ *
+ * @param[in] val the machine word
+ * @param[out] str the digits, most significant bit first (not NUL-terminated)
+ */
 void translate_val(const uint16_t val, char str[16]);
 
+/**
+ * @brief Renders a block of machine words in the .hack text format, one word
+ * per line.
+ *
+ * @param[in] words the machine words
+ * @param[in] nwords number of words
+ * @param[out] out buffer of at least nwords * TRANSLATE_LINE_LEN bytes
+ * @return number of bytes written to out
+ */
+size_t translate_render(const uint16_t* const words, const size_t nwords,
+                        char* const out);
+/*
+ * Binary ROM images are a fixed 16-byte header followed by the machine words,
+ * so that loaders can map the file and use the words in place:
+ *
+ *   offset  size  contents
+ *        0     4  magic number "HROM"
+ *        4     2  format version (ROM_VERSION)
+ *        6     2  length of the header in bytes (ROM_HEADER_LEN)
+ *        8     4  number of machine words
+ *       12     4  CRC-32 (IEEE 802.3, as used by zlib) of the word bytes
+ *       16   2*n  machine words
+ *
+ * All multi-byte fields, including the words, are little-endian.
+ */
+#define ROM_MAGIC "HROM"
+#define ROM_VERSION 1
+#define ROM_HEADER_LEN 16
+
+/**
+ * @brief Renders a block of machine words as a binary ROM image.
+ *
+ * @param[in] words the machine words
+ * @param[in] nwords number of words
+ * @param[out] out buffer of at least ROM_HEADER_LEN + 2 * nwords bytes
+ * @return number of bytes written to out
+ */
+size_t translate_render_rom(const uint16_t* const words, const size_t nwords,
+                            char* const out);
+
+/* CRC-32 (IEEE 802.3, as used by zlib) of a block of bytes, for checking
+ * binary files on the way back in */
+uint32_t translate_crc32(const unsigned char* const data, const size_t len);
+
+/* stores a value little-endian, as every field of the binary formats is */
+void translate_put_le16(unsigned char* const out, const uint16_t val);
+
+void translate_put_le32(unsigned char* const out, const uint32_t val);
+
 #endif // HACK_ASSEMBLER_TRANSLATOR_H
@@ -22,7 +22,75 @@ diff -s RectL.hack RectL.key
 diff -s Pong.hack Pong.key
 diff -s PongL.hack PongL.key
 
+# parallel assembly
+rm ./Pong.hack
+../Assembler -j 4 Pong.asm
+diff -s Pong.hack Pong.key
+
+# binary ROM image output
+../Assembler -b Max.asm
+diff -s Max.rom MaxRom.key
+
+# peephole optimization, which leaves code with numeric jumps alone
+../Assembler -O Peephole.asm
+diff -s Peephole.hack Peephole.key
+../Assembler -O MaxL.asm
+diff -s MaxL.hack MaxL.key
+
+# dead code elimination
+../Assembler -O2 DeadCode.asm
+diff -s DeadCode.hack DeadCode.key
+
+# statistics go to their own file, leaving the output alone
+../Assembler -O2 --stats=DeadCode.stats DeadCode.asm
+diff -s DeadCode.hack DeadCode.key
+grep -o '"instructions": 40, "labels": 7, "variables": 0, "words": 31' \
+    DeadCode.stats
+rm DeadCode.stats
+
+# symbol maps go next to the program, which is left alone
+../Assembler -g Rect.asm
+diff -s Rect.hack Rect.key
+diff -s Rect.sym RectSym.key
+rm Rect.sym
+
+# programs too large for ROM are refused, with a breakdown by function
+cat Pong.asm PongL.asm | ../Assembler - 2> Overflow.err > /dev/null
+diff -s Overflow.err Overflow.key
+
+# line numbers keep counting past 65535
+{ cat PongL.asm PongL.asm PongL.asm; echo "D=D+"; } |
+    ../Assembler --no-rom-limit - 2> Lines.err > /dev/null
+diff -s Lines.err Lines.key
+rm ./*.err
+
+# separate assembly: Pong in three pieces, linked back together
+head -n 10000 Pong.asm > PongA.asm
+sed -n '10001,20000p' Pong.asm > PongB.asm
+tail -n +20001 Pong.asm > PongC.asm
+../Assembler -c PongA.asm PongB.asm PongC.asm
+../hacklink -o PongLinked.hack PongA.hobj PongB.hobj PongC.hobj
+diff -s PongLinked.hack Pong.key
+rm PongA.asm PongB.asm PongC.asm PongLinked.hack ./*.hobj
+
+# the first definition of a label in link order wins, optimized or not
+../Assembler -c -O LinkA.asm LinkB.asm
+../hacklink -o Linked.hack LinkA.hobj LinkB.hobj
+cat LinkA.asm LinkB.asm | ../Assembler - > LinkedKey.hack
+diff -s Linked.hack LinkedKey.hack
+rm Linked.hack LinkedKey.hack ./*.hobj
+
+# streaming through a pipe
+cat PongL.asm | ../Assembler - > PongL.hack
+diff -s PongL.hack PongL.key
+
+# batch assembly of a whole directory
 rm ./*.hack
+../Assembler -j 4 .
+diff -s Rect.hack Rect.key
+diff -s PongL.hack PongL.key
+
+rm ./*.hack ./*.rom
 
 ../Assembler Add.asm
 ../Assembler Max.asm
@@ -5,33 +5,270 @@
  *
  * @brief This file is part of the HackAssember program, an assembler for the
  * Hack architecture, as described in "The Elements of Computing Systems", 2nd
- * Ed. by Nisan and Schocken. This module handles file I/O, constructs the
- * symbol table, passes instructions to the parser and later to the translator,
- * and catenates the binary opcodes returned by the translator.
+ * Ed. by Nisan and Schocken. This module handles the command line and file
+ * I/O, handing the actual assembly over to libhackasm (see hackasm.h).
  *
  * @copyright Vincent Marias, 2024
  */
 
 // standard library headers
 #define _POSIX_C_SOURCE 200809L
-#include <regex.h>  // for regmatch_t, size_t, regoff_t
-#include <stdint.h> // for uint16_t
-#include <stdio.h>  // for NULL, fprintf, stderr, fopen, size_t, getline
-#include <stdlib.h> // for EXIT_FAILURE, calloc, free, EXIT_SUCCESS
-#include <string.h> // for strncmp, memcpy, strncpy, strlen, strcat
+#include <regex.h>   // for regmatch_t, size_t, regoff_t
+#include <stdbool.h> // for bool, true, false
+#include <stdint.h>  // for uint16_t
+#include <stdio.h>   // for NULL, fprintf, stderr, fopen, size_t
+#include <stdlib.h>  // for EXIT_FAILURE, calloc, free, EXIT_SUCCESS
+#include <string.h>  // for strncmp, strcmp, strncpy, strlen, strcat
+
+// POSIX headers
+#include <dirent.h>    // for opendir, readdir, closedir, DIR, struct dirent
+#include <fcntl.h>     // for open, O_RDONLY
+#include <sys/mman.h>  // for mmap, munmap, posix_madvise
+#include <sys/stat.h>  // for fstat, S_ISREG
+#include <sys/types.h> // for ssize_t
+#include <unistd.h>    // for read, close
 
 // project-specific modules
+#include "cli.h"
+#include "hackasm.h"
 #include "parser.h"
-#include "sym_tbl.h"
-#include "translator.h"
+#include "pool.h"
 
-static const char* const OUT_EXT = ".hack";
+static const char* const ASM_EXT = ".asm";
 
-int main(int argc, char** argv) {
-    if (argc != 2) {
-        fprintf(stderr, "[ERROR] Usage: %s <path to file>.asm\n", argv[0]);
-        return EXIT_FAILURE;
+/* path standing in for stdin (input) and stdout (output) */
+static const char* const STDIO_PATH = "-";
+static const char* const STDIO_NAME = "<stdin>";
+
+/* the entire contents of a source file, held in memory for both passes */
+typedef struct source {
+    char* data;
+    size_t len;
+    bool mapped; /* data is a read-only mapping of the file, not heap memory */
+} source;
+
+/**
+ * @brief Makes everything readable from a file descriptor available in memory.
+ * Regular files are mapped read-only, so parsing does not copy any of the
+ * input; anything that cannot be mapped (pipes, terminals) is read into a
+ * growable heap buffer instead, once, since assembly needs two passes.
+ *
+ * @param[in] fd file descriptor open for reading, left open
+ * @param[out] src the contents of the file
+ * @return file was/was not able to be read
+ */
+static bool source_load(const int fd, source* const src) {
+    *src = (source){NULL, 0, false};
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        return false;
+    }
+
+    if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+        void* data =
+            mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED) {
+            posix_madvise(data, (size_t)sb.st_size, POSIX_MADV_SEQUENTIAL);
+
+            *src = (source){data, (size_t)sb.st_size, true};
+            return true;
+        }
+    }
+
+    /* fall back to reading the whole thing into memory */
+    size_t cap = 1 << 16;
+    char* data = malloc(cap);
+    ssize_t nread = 0;
+
+    while (data && (nread = read(fd, data + src->len, cap - src->len)) > 0) {
+        src->len += (size_t)nread;
+
+        if (src->len == cap) {
+            char* grown = realloc(data, cap * 2);
+            if (!grown) {
+                nread = -1;
+                break;
+            }
+            data = grown;
+            cap *= 2;
+        }
+    }
+
+    if (!data || nread == -1) {
+        free(data);
+        src->len = 0;
+        return false;
+    }
+
+    src->data = data;
+    return true;
+}
+
+/**
+ * @brief Makes the contents of a source file available in memory.
+ *
+ * @param[in] path path to the source file
+ * @param[out] src the contents of the file
+ * @return file was/was not able to be opened and read
+ */
+static bool source_open(const char* const path, source* const src) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        *src = (source){NULL, 0, false};
+        return false;
+    }
+
+    const bool ok = source_load(fd, src);
+    close(fd);
+
+    return ok;
+}
+
+/* writes all of buf to fd, however many calls that takes */
+static bool write_all(const int fd, const char* buf, size_t len) {
+    while (len) {
+        const ssize_t nwritten = write(fd, buf, len);
+        if (nwritten == -1) {
+            return false;
+        }
+        buf += nwritten;
+        len -= (size_t)nwritten;
+    }
+
+    return true;
+}
+
+static void source_close(source* const src) {
+    if (src->mapped) {
+        munmap(src->data, src->len);
+    } else {
+        free(src->data);
+    }
+
+    *src = (source){NULL, 0, false};
+}
+
+/* reports a diagnostic from the library, in terms of the file it came from */
+static void print_diag(const hackasm_diag* const diag, const char* const name,
+                       const int name_len) {
+    switch (diag->kind) {
+    case HACKASM_SYNTAX:
+        fprintf(stderr,
+                "[ERROR] Syntax error at %.*s:%u for instruction\n\t%.*s\n",
+                name_len, name, diag->line, (int)diag->len, diag->text);
+        break;
+    case HACKASM_ENCODING:
+        fprintf(stderr, "[ERROR] Failed to translate instruction at %.*s:%u\n",
+                name_len, name, diag->line);
+        break;
+    case HACKASM_REFERENCE:
+        fprintf(stderr,
+                "[ERROR] Failed to resolve reference \"%.*s\" at %.*s:%u\n",
+                (int)diag->len, diag->text, name_len, name, diag->line);
+        break;
+    case HACKASM_ROM_SIZE:
+        fprintf(stderr, "[ERROR] Program %.*s does not fit in ROM (%d words)\n",
+                name_len, name, HACKASM_ROM_WORDS);
+        break;
+    case HACKASM_SRC_SIZE:
+        fprintf(stderr, "[ERROR] Source %.*s is too large to assemble\n",
+                name_len, name);
+        break;
+    case HACKASM_CORRUPT: /* only comes up when linking */
+        fprintf(stderr, "[ERROR] Corrupt object file %.*s\n", name_len, name);
+        break;
+    case HACKASM_RESOURCES:
+        fprintf(stderr, "[ERROR] Out of memory assembling %.*s\n",
+                name_len, name);
+        break;
+    }
+}
+
+/* settings shared by every file assembled in one run */
+typedef struct options {
+    hackasm_format format; /* .hack text, .rom image or .hobj object */
+    size_t nthreads;       /* threads to assemble on */
+    unsigned optimize;     /* optimization level */
+    bool no_rom_limit;     /* assemble programs too large for ROM anyway */
+    bool symbols;          /* also write a .sym symbol map for each program */
+
+    bool stats;             /* report statistics for every file */
+    const char* stats_path; /* JSON Lines file to report to, NULL for stderr */
+} options;
+
+/**
+ * @brief Writes rendered output next to the source it came from.
+ *
+ * @param[in] stem path to the source file, up to its extension
+ * @param[in] stem_len length of the stem
+ * @param[in] format what was rendered, which decides the extension
+ * @param[in] out the rendered output
+ * @param[in] out_len length of the output in bytes
+ * @return file was/was not written
+ */
+static bool write_output(const char* const stem, const size_t stem_len,
+                         const hackasm_format format, const char* const out,
+                         const size_t out_len) {
+    /* output filepath is same as input w/ extension changed to match */
+    const char* const ext = hackasm_format_ext(format);
+    char* filename_out = calloc(stem_len + strlen(ext) + 1, sizeof(char));
+    if (!filename_out) {
+        fprintf(stderr, "[ERROR] Out of memory\n");
+        return false;
     }
+    strncpy(filename_out, stem, stem_len);
+    strcat(filename_out, ext);
+
+    FILE* fout = fopen(filename_out, (format == HACKASM_TEXT ? "w" : "wb"));
+    bool ok = true;
+
+    if (!fout) {
+        fprintf(stderr, "[ERROR] Failed to open otuput file \"%s\"\n",
+                filename_out);
+        ok = false;
+    } else {
+        /* a full disk shows up here, or only once the file is closed */
+        const bool written =
+            (fwrite(out, sizeof(char), out_len, fout) == out_len);
+        if (fclose(fout) || !written) {
+            fprintf(stderr, "[ERROR] Failed to write output file \"%s\"\n",
+                    filename_out);
+            ok = false;
+        }
+    }
+
+    free(filename_out);
+    return ok;
+}
+
+/* statistics for one file, kept until every file is done */
+typedef struct file_stats {
+    bool assembled; /* the source was read and handed to the library */
+    size_t nwords;
+    hackasm_times times;
+    hackasm_stats counts;
+    double write; /* rendering the output and writing it out */
+} file_stats;
+
+/**
+ * @brief Assembles a single .asm file into a .hack (or .rom, or .hobj) file of
+ * the same name, next to it. Errors are reported on stderr as they come up.
+ *
+ * @param[in] path path to the source file
+ * @param[in] opts output settings
+ * @param[in,out] pool threads to split the file up across, or NULL to
+ * assemble it on the calling thread alone
+ * @param[out] stats what assembly got through, or NULL if not wanted
+ * @return file was/was not assembled successfully
+ */
+static bool assemble_file(const char* const path, const options* const opts,
+                          thread_pool* const pool, file_stats* const stats) {
+    bool ok = true;
+
+    /* read from stdin and write to stdout instead of files */
+    const bool stdio = !strcmp(path, STDIO_PATH);
 
     /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
      * FILE I/O
@@ -45,7 +282,11 @@ int main(int argc, char** argv) {
     regoff_t name_off = 0, name_len = 0;
     regoff_t ext_off = 0, ext_len = 0;
 
-    if ((pmatch = match_regex(argv[1], "^(.*/)?([^/\\]*)\\.(.*)$", &nsub))) {
+    if (stdio) {
+        /* nothing to parse, diagnostics name the stream instead */
+        name_len = (regoff_t)strlen(STDIO_NAME);
+    } else if ((pmatch =
+                    match_regex(path, "^(.*/)?([^/\\]*)\\.(.*)$", &nsub))) {
         /* extract filepath without extension */
         if (pmatch[1].rm_so < 0) {
             /* match empty path prefix */
@@ -70,153 +311,420 @@ int main(int argc, char** argv) {
     } else {
         fprintf(stderr,
                 "[ERROR] Input filepath \"%s\" invalid - check you spelling!\n",
-                argv[1]);
-        return EXIT_FAILURE;
+                path);
+        return false;
     }
 
     /* validate file extension as .asm */
-    if (strncmp(argv[1] + ext_off, "asm", (size_t)ext_len)) {
+    if (!stdio && strncmp(path + ext_off, "asm", (size_t)ext_len)) {
         fprintf(stderr,
                 "[ERROR] File extension \"%.*s\" invalid - use <path to "
                 "file>.asm\n",
-                ext_len, argv[1] + ext_off);
-        return EXIT_FAILURE;
+                ext_len, path + ext_off);
+        return false;
+    }
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * ASSEMBLY
+     * hand the whole source over to the library, report what went wrong
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    char* out = NULL;
+    double write_start = 0.0; /* set once there's output to write */
+
+    source src = {NULL, 0, false};
+    const hackasm_opts asm_opts = {pool, opts->optimize, opts->no_rom_limit,
+                                   opts->format == HACKASM_OBJECT,
+                                   opts->symbols};
+    hackasm_result result = {
+        NULL, 0, NULL, NULL, 0, NULL, 0, NULL, 0, NULL, 0, {0, 0, 0, 0}, {0}};
+
+    if (!(stdio ? source_load(STDIN_FILENO, &src) : source_open(path, &src))) {
+        fprintf(stderr, "[ERROR] Failed to open source file \"%s\"\n",
+                (stdio ? STDIO_NAME : path));
+        ok = false;
+        goto EXIT;
+    }
+
+    const bool assembled =
+        hackasm_assemble(src.data, src.len, &asm_opts, &result);
+
+    if (stats) {
+        *stats = (file_stats){true, result.nwords, result.times, result.stats,
+                              0.0};
+    }
+
+    if (!assembled) {
+        for (size_t i = 0; i < result.ndiags; ++i) {
+            print_diag(&result.diags[i],
+                       (stdio ? STDIO_NAME : path + name_off), (int)name_len);
+        }
+        if (result.nfuncs) {
+            cli_print_funcs(&result);
+        }
+        ok = false;
+        goto EXIT;
     }
 
     /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-     * PARSING
-     * process input stream line-by-line
-     * pass lines to the parser, get back instruction struct
-     * enqueue A- and C-instructions, use L-instructions to update symbol table
+     * OUTPUT
+     * render every machine word as text (or as a binary image) in one buffer
+     * write the buffer out in one go
      * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-    sym_tbl* tbl = sym_tbl_alloc();
+    write_start = hackasm_now();
+
+    size_t out_len = 0;
+    out = hackasm_render(&result, opts->format, &asm_opts, &out_len);
 
-    /* used to count instructions in program */
-    uint16_t pc = 0;
+    if (!out) {
+        fprintf(stderr, "[ERROR] Out of memory rendering %.*s\n",
+                (int)name_len, (stdio ? STDIO_NAME : path + name_off));
+        ok = false;
+        goto EXIT;
+    }
+
+    if (stdio) {
+        if (!write_all(STDOUT_FILENO, out, out_len)) {
+            fprintf(stderr, "[ERROR] Failed to write to stdout\n");
+            ok = false;
+        }
+        goto EXIT;
+    }
 
-    /* set up instruction queue */
-    instruction* first_instr = NULL;
-    instruction* curr_instr = NULL;
+    if (!write_output(path + path_no_ext_off, (size_t)path_no_ext_len,
+                      opts->format, out, out_len)) {
+        ok = false;
+        goto EXIT;
+    }
 
-    char* line = NULL;
-    FILE* fin = fopen(argv[1], "r");
+    /* the symbol map goes alongside the program */
+    if (opts->symbols) {
+        free(out);
+        out = hackasm_render(&result, HACKASM_SYMBOLS, &asm_opts, &out_len);
 
-    if (!fin) {
-        fprintf(stderr, "[ERROR] Failed to open source file \"%s\"\n", argv[1]);
-        return EXIT_FAILURE;
+        if (!out) {
+            fprintf(stderr, "[ERROR] Out of memory rendering %.*s\n",
+                    (int)name_len, path + name_off);
+            ok = false;
+            goto EXIT;
+        }
+
+        ok = write_output(path + path_no_ext_off, (size_t)path_no_ext_len,
+                          HACKASM_SYMBOLS, out, out_len);
+    }
+
+EXIT:
+    if (stats && write_start > 0.0) {
+        stats->write = hackasm_now() - write_start;
     }
 
-    size_t glen = 0;
-    for (uint16_t nline = 1; getline(&line, &glen, fin) != -1; ++nline) {
-        instruction* instr = parse_instr(line, nline);
+    free(out);
 
-        if (!instr) {
-            fprintf(stderr,
-                    "[ERROR] Syntax error at %.*s:%u for instruction\n\t%s\n",
-                    name_len, argv[1] + name_off, nline, line);
-            sym_tbl_free(tbl);
-            return EXIT_FAILURE;
+    hackasm_result_free(&result);
+    source_close(&src);
+
+    return ok;
+}
+
+/* a batch of files, assembled concurrently one per task */
+typedef struct batch {
+    char** paths;
+    size_t npaths;
+    const options* opts;
+    bool* ok;           /* result for each file */
+    file_stats* stats;  /* statistics for each file, NULL if not wanted */
+} batch;
+
+static void assemble_job(void* ctx, size_t idx) {
+    batch* const b = ctx;
+
+    /* files are the unit of work here, so each one runs single-threaded */
+    b->ok[idx] = assemble_file(b->paths[idx], b->opts, NULL,
+                               (b->stats ? &b->stats[idx] : NULL));
+}
+
+/* appends a copy of [dir/]name to the batch */
+static bool push_path(batch* const b, size_t* const cap, const char* const dir,
+                      const char* const name) {
+    if (b->npaths == *cap) {
+        const size_t new_cap = (*cap ? *cap * 2 : 8);
+        char** paths = realloc(b->paths, new_cap * sizeof(char*));
+        if (!paths) {
+            return false;
         }
+        b->paths = paths;
+        *cap = new_cap;
+    }
 
-        if (instr->type == L_INSTR) {
-            /* update symbol table */
-            sym_tbl_insert(tbl, instr->symbol, pc);
-            free(instr->symbol);
-            free(instr);
-        } else if (instr->type == A_INSTR || instr->type == C_INSTR) {
-            if (!first_instr) {
-                first_instr = instr;
-            }
+    const size_t dir_len = (dir ? strlen(dir) + 1 : 0);
+    char* path = malloc(dir_len + strlen(name) + 1);
+    if (!path) {
+        return false;
+    }
 
-            /* add the new instruction to the back of the queue */
-            if (curr_instr) {
-                curr_instr->next = instr;
-            }
-            curr_instr = instr;
+    if (dir) {
+        strcpy(path, dir);
+        strcat(path, "/");
+        strcat(path, name);
+    } else {
+        strcpy(path, name);
+    }
 
-            ++pc; /* only count instructions that generate code */
-        } else {
-            free(instr);
+    b->paths[b->npaths++] = path;
+    return true;
+}
+
+static int cmp_paths(const void* lhs, const void* rhs) {
+    return strcmp(*(char* const*)lhs, *(char* const*)rhs);
+}
+
+/* adds every .asm file in a directory to the batch, in name order */
+static bool push_dir(batch* const b, size_t* const cap, const char* const dir) {
+    DIR* dp = opendir(dir);
+    if (!dp) {
+        return false;
+    }
+
+    const size_t first = b->npaths;
+    const size_t ext_len = strlen(ASM_EXT);
+    struct dirent* entry = NULL;
+    bool ok = true;
+
+    while (ok && (entry = readdir(dp))) {
+        const size_t len = strlen(entry->d_name);
+
+        if (len > ext_len && !strcmp(entry->d_name + len - ext_len, ASM_EXT)) {
+            ok = push_path(b, cap, dir, entry->d_name);
         }
     }
 
-    fclose(fin);
-    free(line);
-    line = NULL;
+    closedir(dp);
 
-    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-     * TRANSLATION
-     * iterate trough instruction queue
-     * pass instruction, symbol table to parser for symbol resolution
-     * pass resolved instruction fields to translator for binary translation
-     * catenate binary fields together to form complete binary instruction
-     * write out binary instruction
-     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+    /* readdir order is arbitrary, keep runs reproducible */
+    qsort(b->paths + first, b->npaths - first, sizeof(char*), cmp_paths);
 
-    uint16_t nvars = 16; /* used to count variables in program */
+    return ok;
+}
 
-    /* output filepath is same as input w/ extension changed to .hack */
-    char* filename_out =
-        calloc((size_t)path_no_ext_len + strlen(OUT_EXT) + 1, sizeof(char));
-    strncpy(filename_out, argv[1] + path_no_ext_off, (size_t)path_no_ext_len);
-    strcat(filename_out, OUT_EXT);
+/**
+ * @brief Reports the statistics for every file that made it as far as the
+ * library, in the order the files were given: as a few lines each on stderr,
+ * or as one JSON object per file (JSON Lines) if a path was given.
+ *
+ * @param[in] b the files and their statistics
+ * @return statistics were/were not written out
+ */
+static bool report_stats(const batch* const b) {
+    const char* const stats_path = b->opts->stats_path;
+    FILE* const f = (stats_path ? fopen(stats_path, "w") : stderr);
+
+    if (!f) {
+        fprintf(stderr, "[ERROR] Failed to open statistics file \"%s\"\n",
+                stats_path);
+        return false;
+    }
 
-    FILE* fout = fopen(filename_out, "w");
+    for (size_t i = 0; i < b->npaths; ++i) {
+        const file_stats* const st = &b->stats[i];
+        const hackasm_times* const t = &st->times;
+        const hackasm_stats* const c = &st->counts;
+        const double load =
+            (c->tbl_cap ? (double)c->tbl_len / (double)c->tbl_cap : 0.0);
 
-    if (!fout) {
-        fprintf(stderr, "[ERROR] Failed to open otuput file \"%s\"\n",
-                filename_out);
-        return EXIT_FAILURE;
+        if (!st->assembled) {
+            continue;
+        }
+
+        if (!stats_path) {
+            fprintf(f,
+                    "[STATS] %s\n"
+                    "\t%zu lines, %zu instructions, %zu labels, "
+                    "%zu variables -> %zu words\n"
+                    "\ttime (ms): parse %.3f, optimize %.3f, resolve %.3f, "
+                    "encode %.3f, write %.3f\n"
+                    "\tsymbol table: %zu of %zu slots (%.1f%% full), "
+                    "longest probe %zu\n"
+                    "\tallocations: %zu\n",
+                    b->paths[i], c->nlines, c->ninstrs, c->nlabels, c->nvars,
+                    st->nwords, t->parse * 1e3, t->optimize * 1e3,
+                    t->resolve * 1e3, t->encode * 1e3, st->write * 1e3,
+                    c->tbl_len, c->tbl_cap, load * 100, c->tbl_longest_probe,
+                    c->nallocs);
+            continue;
+        }
+
+        fprintf(f, "{\"input\": ");
+        cli_put_json_str(f, b->paths[i]);
+        fprintf(f,
+                ", \"lines\": %zu, \"instructions\": %zu, \"labels\": %zu, "
+                "\"variables\": %zu, \"words\": %zu, \"parse_s\": %.6f, "
+                "\"optimize_s\": %.6f, \"resolve_s\": %.6f, "
+                "\"encode_s\": %.6f, \"write_s\": %.6f, \"tbl_symbols\": %zu, "
+                "\"tbl_slots\": %zu, \"tbl_load\": %.4f, "
+                "\"tbl_longest_probe\": %zu, \"allocations\": %zu}\n",
+                c->nlines, c->ninstrs, c->nlabels, c->nvars, st->nwords,
+                t->parse, t->optimize, t->resolve, t->encode, st->write,
+                c->tbl_len, c->tbl_cap, load, c->tbl_longest_probe,
+                c->nallocs);
     }
 
-    free(filename_out);
-    filename_out = NULL;
-
-    for (instruction* instr = first_instr; instr;) {
-        /* if symbol needs to be resolved, attempt to resolve to an address */
-        if ((instr->type == A_INSTR || instr->type == L_INSTR) &&
-            !instr->resolved && !resolve_reference(instr, tbl, &nvars)) {
-            fprintf(stderr,
-                    "[ERROR] Failed to resolve reference \"%s\" at %.*s:%u\n",
-                    instr->symbol, name_len, argv[1] + name_off,
-                    instr->line_number);
-            fclose(fout);
-            sym_tbl_free(tbl);
-            return EXIT_FAILURE;
-        }
-
-        /* the actual "bits" in the translated instruction */
-        char instr_bits[16] = {'0'};
-
-        if (instr->type == A_INSTR) {
-            /* A-instructions just need a decimal->binary value translation */
-            translate_val(instr->addr, instr_bits);
-        } else if (instr->type == C_INSTR) {
-            /* all C-instructions start with 111, then catenate other fields */
-            memcpy(instr_bits, "111", 3);
-            memcpy(instr_bits + 3, translate_comp(instr->comp), 7);
-            memcpy(instr_bits + 10, translate_dest(instr->dest), 3);
-            memcpy(instr_bits + 13, translate_jump(instr->jump), 3);
-
-            free(instr->comp);
-            free(instr->dest);
-            free(instr->jump);
+    return (!stats_path || !fclose(f));
+}
+
+int main(int argc, char** argv) {
+    int EXIT_STATUS = EXIT_SUCCESS;
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * OPTIONS
+     * -b, --binary     write a binary ROM image (.rom) instead of .hack text
+     * -c, --object     write a relocatable object (.hobj) for hacklink
+     * -g, --symbols    also write a symbol map (.sym) next to each program
+     * -j, --jobs <n>   assemble on n threads (0 for one per processor)
+     * -O, -O1          run the peephole optimizer
+     * -O2              also remove unreachable code and unused labels
+     * --no-rom-limit   assemble programs too large for the ROM anyway
+     * --stats[=<path>] report counts and timings for every file on stderr,
+     *                  or as JSON Lines to path
+     * any number of .asm files and directories of .asm files may follow, or
+     * "-" alone to read from stdin and write to stdout
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    options opts = {HACKASM_TEXT, 1, 0, false, false, false, NULL};
+    batch b = {NULL, 0, &opts, NULL, NULL};
+    size_t cap = 0;
+    bool usage = false;
+    thread_pool* pool = NULL;
+
+    for (int i = 1; i < argc && !usage; ++i) {
+        if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--binary")) {
+            opts.format = HACKASM_ROM;
+        } else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--object")) {
+            opts.format = HACKASM_OBJECT;
+        } else if (!strcmp(argv[i], "-g") || !strcmp(argv[i], "--symbols")) {
+            opts.symbols = true;
+        } else if (!strcmp(argv[i], "-O") || !strcmp(argv[i], "-O1")) {
+            opts.optimize = 1;
+        } else if (!strcmp(argv[i], "-O2")) {
+            opts.optimize = 2;
+        } else if (!strcmp(argv[i], "--no-rom-limit")) {
+            opts.no_rom_limit = true;
+        } else if (!strcmp(argv[i], "--stats")) {
+            opts.stats = true;
+        } else if (!strncmp(argv[i], "--stats=", 8) && argv[i][8]) {
+            opts.stats = true;
+            opts.stats_path = argv[i] + 8;
+        } else if ((!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs")) &&
+                   i + 1 < argc) {
+            char* end = NULL;
+            opts.nthreads = strtoul(argv[++i], &end, 10);
+            if (*end) {
+                usage = true;
+            }
+            if (!opts.nthreads) {
+                opts.nthreads = pool_ncpus();
+            }
+        } else if (argv[i][0] != '-' || !strcmp(argv[i], STDIO_PATH)) {
+            struct stat sb;
+
+            if (strcmp(argv[i], STDIO_PATH) && !stat(argv[i], &sb) &&
+                S_ISDIR(sb.st_mode)) {
+                if (!push_dir(&b, &cap, argv[i])) {
+                    fprintf(stderr,
+                            "[ERROR] Failed to read directory \"%s\"\n",
+                            argv[i]);
+                    EXIT_STATUS = EXIT_FAILURE;
+                    goto EXIT;
+                }
+            } else if (!push_path(&b, &cap, NULL, argv[i])) {
+                EXIT_STATUS = EXIT_FAILURE;
+                goto EXIT;
+            }
         } else {
-            /* L-instructions and comments/blank lines don't generate code */
-            continue;
+            usage = true;
         }
+    }
 
-        fwrite(instr_bits, sizeof(char), 16, fout);
-        fwrite("\n", sizeof(char), 1, fout);
+    /* there is only the one stdin/stdout, so "-" can't be part of a batch */
+    for (size_t i = 0; i < b.npaths && b.npaths > 1; ++i) {
+        if (!strcmp(b.paths[i], STDIO_PATH)) {
+            usage = true;
+        }
+    }
 
-        instruction* last_instr = instr;
-        instr = instr->next;
-        free(last_instr);
+    /* symbol maps are files of their own, and objects have nothing final to
+     * map yet */
+    for (size_t i = 0; i < b.npaths && opts.symbols; ++i) {
+        if (!strcmp(b.paths[i], STDIO_PATH) ||
+            opts.format == HACKASM_OBJECT) {
+            usage = true;
+        }
     }
 
-    fclose(fout);
-    sym_tbl_free(tbl);
+    if (usage || !b.npaths) {
+        fprintf(stderr,
+                "[ERROR] Usage: %s [-b|--binary|-c|--object] [-g|--symbols] "
+                "[-j|--jobs <n>] [-O|-O2] [--no-rom-limit] "
+                "[--stats[=<path>]] "
+                "<path to file>.asm|<path to directory>...|-\n",
+                argv[0]);
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
+    pool = pool_alloc(opts.nthreads);
+    if (!pool) {
+        fprintf(stderr, "[ERROR] Failed to start worker threads\n");
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
+    b.ok = calloc(b.npaths, sizeof(bool));
+    if (opts.stats) {
+        b.stats = calloc(b.npaths, sizeof(file_stats));
+    }
+
+    if (!b.ok || (opts.stats && !b.stats)) {
+        fprintf(stderr, "[ERROR] Out of memory\n");
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
+    /* a lone file gets every thread to itself; several files are spread
+     * across the threads instead, one failing doesn't stop the others */
+    if (b.npaths == 1) {
+        b.ok[0] = assemble_file(b.paths[0], &opts, pool, b.stats);
+    } else {
+        pool_for(pool, b.npaths, assemble_job, &b);
+    }
+
+    size_t nfailed = 0;
+    for (size_t i = 0; i < b.npaths; ++i) {
+        nfailed += !b.ok[i];
+    }
+
+    if (nfailed) {
+        if (b.npaths > 1) {
+            fprintf(stderr, "[ERROR] %zu of %zu files failed to assemble\n",
+                    nfailed, b.npaths);
+        }
+        EXIT_STATUS = EXIT_FAILURE;
+    }
+
+    /* only once every file is done, so reports don't interleave */
+    if (opts.stats && !report_stats(&b)) {
+        EXIT_STATUS = EXIT_FAILURE;
+    }
+
+EXIT:
+    pool_free(pool);
+
+    for (size_t i = 0; i < b.npaths; ++i) {
+        free(b.paths[i]);
+    }
+    free(b.paths);
+    free(b.ok);
+    free(b.stats);
 
-    return EXIT_SUCCESS;
+    return EXIT_STATUS;
 }
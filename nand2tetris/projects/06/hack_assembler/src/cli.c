@@ -0,0 +1,96 @@
+/**
+ * @file cli.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module holds what the programs built on
+ * libhackasm (the assembler, the linker and the benchmarks) have in common:
+ * reading their inputs and reporting on the results.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>  // for fprintf, fputc, stderr, FILE, fopen, fread
+#include <stdlib.h> // for malloc, realloc, free
+
+#include "cli.h"
+
+/* how many functions to list when a program doesn't fit in ROM */
+static const size_t MAX_FUNCS_SHOWN = 10;
+
+char* cli_slurp(const char* const path, size_t* const len) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+
+    size_t cap = 1 << 16;
+    char* data = malloc(cap);
+    *len = 0;
+
+    size_t nread = 0;
+    while (data && (nread = fread(data + *len, 1, cap - *len, f)) > 0) {
+        *len += nread;
+
+        if (*len == cap) {
+            char* grown = realloc(data, cap * 2);
+            if (!grown) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            cap *= 2;
+        }
+    }
+
+    fclose(f);
+    return data;
+}
+
+void cli_print_funcs(const hackasm_result* const result) {
+    size_t nwords = 0;
+    for (size_t i = 0; i < result->nfuncs; ++i) {
+        nwords += result->funcs[i].nwords;
+    }
+
+    fprintf(stderr, "\t%zu words in all, largest functions first:\n", nwords);
+
+    for (size_t i = 0; i < result->nfuncs && i < MAX_FUNCS_SHOWN; ++i) {
+        const hackasm_func* const func = &result->funcs[i];
+
+        if (func->name) {
+            fprintf(stderr, "\t%8zu  %.*s\n", func->nwords, (int)func->len,
+                    func->name);
+        } else {
+            fprintf(stderr, "\t%8zu  (before the first function)\n",
+                    func->nwords);
+        }
+    }
+
+    if (result->nfuncs > MAX_FUNCS_SHOWN) {
+        fprintf(stderr, "\t     ...  and %zu more\n",
+                result->nfuncs - MAX_FUNCS_SHOWN);
+    }
+}
+
+void cli_put_json_str(FILE* const f, const char* s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        const unsigned char c = (unsigned char)*s;
+
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if (c < 0x20) {
+            /* JSON strings can't hold control characters as they are */
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
@@ -0,0 +1,854 @@
+/**
+ * @file hackasm.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module constructs the symbol table, passes
+ * instructions to the parser and later to the translator, and collects the
+ * machine words returned by the translator into a ROM image.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool, true, false
+#include <stdint.h>  // for uint16_t, uint32_t
+#include <stdlib.h>  // for malloc, calloc, free, qsort
+#include <string.h>  // for memchr, memcpy
+#include <time.h>    // for clock_gettime, CLOCK_MONOTONIC, timespec
+
+#include "hackasm.h"
+#include "object.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "pool.h"
+#include "scan.h"
+#include "sym_tbl.h"
+#include "symmap.h"
+#include "translator.h"
+
+/* don't bother splitting sources into pieces smaller than this (bytes) */
+static const size_t MIN_CHUNK_LEN = 1 << 16;
+
+/* pieces per thread, so that uneven pieces still keep every thread busy */
+static const size_t CHUNKS_PER_THREAD = 4;
+
+static const hackasm_diag OUT_OF_MEMORY = {HACKASM_RESOURCES, 0, NULL, 0};
+
+/* a result holding nothing at all */
+static const hackasm_result EMPTY_RESULT = {
+    NULL, 0, NULL, NULL, 0, NULL, 0, NULL, 0, NULL, 0, {0, 0, 0, 0}, {0}};
+
+/* a line-aligned piece of the source, parsed and encoded on its own */
+typedef struct chunk {
+    size_t begin, end; /* byte range in the source */
+
+    instr_array prog;   /* A- and C-instructions */
+    label_array labels; /* L-instructions, indexed relative to the chunk */
+
+    uint32_t nlines;    /* number of lines in the chunk */
+    uint32_t line_base; /* number of lines before the chunk */
+    size_t instr_base;  /* number of instructions before the chunk */
+
+    /* indices of A-instructions referring to variables, in source order */
+    uint32_t* pending;
+    size_t npending;
+
+    /* the first error in the chunk, if any; syntax errors are numbered
+     * relative to the chunk */
+    bool failed;
+    hackasm_diag err;
+} chunk;
+
+/* state shared by every task working on one source */
+typedef struct assembly {
+    const char* src;
+    size_t len;
+    chunk* chunks;
+    size_t nchunks;
+    sym_tbl* tbl;  /* read-only while tasks are running */
+    uint16_t* rom;   /* the encoded program */
+    uint32_t* lines; /* source line of each word, NULL if not wanted */
+} assembly;
+
+/* phase 1: split a chunk into lines, parse each, queue up the results */
+static void parse_chunk(void* ctx, size_t idx) {
+    assembly* const as = ctx;
+    chunk* const ch = &as->chunks[idx];
+    const char* const data = as->src;
+
+    /* the size is a first guess from the length of the chunk, the queues grow
+     * as needed */
+    if (!instr_array_init(&ch->prog, (ch->end - ch->begin) / 16) ||
+        !label_array_init(&ch->labels, 0)) {
+        ch->failed = true;
+        ch->err = (hackasm_diag){HACKASM_RESOURCES, 0, NULL, 0};
+        return;
+    }
+
+    size_t off = ch->begin;
+    uint32_t nline = 1;
+
+    line_scanner sc;
+    scan_init(&sc, data, ch->begin, ch->end);
+
+    for (; off < ch->end; ++nline) {
+        /* each line runs up to and including its endline character */
+        const size_t len = scan_next(&sc) - off;
+
+        instruction parsed;
+
+        if (!parse_instr(data, off, len, nline, &parsed)) {
+            ch->failed = true;
+            ch->err = (hackasm_diag){HACKASM_SYNTAX, nline, data + off, len};
+            return;
+        }
+
+        off += len;
+
+        if (parsed.type == L_INSTR) {
+            /* remember the label until every chunk knows its address */
+            label_def* label = label_array_push(&ch->labels);
+            if (!label) {
+                ch->failed = true;
+                ch->err = (hackasm_diag){HACKASM_RESOURCES, 0, NULL, 0};
+                return;
+            }
+            *label = (label_def){parsed.symbol, (uint32_t)ch->prog.len};
+        } else if (parsed.type == A_INSTR || parsed.type == C_INSTR) {
+            /* add the new instruction to the back of the queue */
+            instruction* instr = instr_array_push(&ch->prog);
+            if (!instr) {
+                ch->failed = true;
+                ch->err = (hackasm_diag){HACKASM_RESOURCES, 0, NULL, 0};
+                return;
+            }
+            *instr = parsed;
+        }
+    }
+
+    ch->nlines = nline - 1;
+}
+
+/* phase 2: resolve references to labels and predefined symbols, encode the
+ * chunk into its slice of the ROM; variables are left for later */
+static void encode_chunk(void* ctx, size_t idx) {
+    assembly* const as = ctx;
+    chunk* const ch = &as->chunks[idx];
+    const char* const data = as->src;
+    uint16_t* const rom = as->rom + ch->instr_base;
+
+    ch->pending = malloc((ch->prog.len ? ch->prog.len : 1) * sizeof(uint32_t));
+    if (!ch->pending) {
+        ch->failed = true;
+        ch->err = (hackasm_diag){HACKASM_RESOURCES, 0, NULL, 0};
+        return;
+    }
+
+    for (size_t i = 0; i < ch->prog.len; ++i) {
+        instruction* const instr = &ch->prog.instrs[i];
+        instr->line_number += ch->line_base;
+
+        if (as->lines) {
+            as->lines[ch->instr_base + i] = instr->line_number;
+        }
+
+        if (instr->type == A_INSTR) {
+            if (!instr->resolved) {
+                const uint16_t addr = sym_tbl_lookup(
+                    as->tbl, data + instr->symbol.off, instr->symbol.len);
+
+                if (addr == SYM_TBL_NPOS) {
+                    /* must be a variable - those get numbered in order */
+                    ch->pending[ch->npending++] = (uint32_t)i;
+                    continue;
+                }
+
+                instr->addr = addr;
+                instr->resolved = true;
+            }
+
+            /* A-instructions are just their address value */
+            rom[i] = instr->addr;
+            continue;
+        }
+
+        /* C-instructions are the fixed prefix OR'd with the other fields */
+        const uint16_t comp =
+            translate_comp(data + instr->comp.off, instr->comp.len);
+        const uint16_t dest =
+            translate_dest(data + instr->dest.off, instr->dest.len);
+        const uint16_t jump =
+            translate_jump(data + instr->jump.off, instr->jump.len);
+
+        if (comp == TRANSLATE_ERR || dest == TRANSLATE_ERR ||
+            jump == TRANSLATE_ERR) {
+            ch->failed = true;
+            ch->err = (hackasm_diag){HACKASM_ENCODING, instr->line_number,
+                                     NULL, 0};
+            return;
+        }
+
+        rom[i] = C_PREFIX | comp | dest | jump;
+    }
+}
+
+/* orders functions largest first, then by address */
+static int cmp_funcs(const void* lhs, const void* rhs) {
+    const hackasm_func* const a = lhs;
+    const hackasm_func* const b = rhs;
+
+    if (a->nwords != b->nwords) {
+        return (a->nwords < b->nwords ? 1 : -1);
+    }
+    return (a->address > b->address) - (a->address < b->address);
+}
+
+/**
+ * @brief Splits a program that doesn't fit in ROM up by function, so the
+ * caller can see where the space went.
+ *
+ * @param[in,out] funcs every label in the program (nwords unused), in order
+ * of address, with room for one more; measured in place and handed over to
+ * the result, largest first
+ * @param[in] nlabels number of labels
+ * @param[in] ninstrs number of instructions in the program
+ * @param[out] result where the functions go
+ */
+static void measure_funcs(hackasm_func* const funcs, const size_t nlabels,
+                          const size_t ninstrs, hackasm_result* const result) {
+    size_t nfuncs = 0;
+    hackasm_func func = {NULL, 0, 0, 0}; /* the one being measured */
+
+    /* never writes past the label being read, so this can work in place */
+    for (size_t i = 0; i < nlabels; ++i) {
+        const hackasm_func label = funcs[i];
+
+        /* labels inside a function don't start a new one */
+        if (memchr(label.name, '$', label.len)) {
+            continue;
+        }
+
+        func.nwords = label.address - func.address;
+        if (func.nwords) {
+            funcs[nfuncs++] = func;
+        }
+        func = label;
+    }
+
+    func.nwords = ninstrs - func.address;
+    if (func.nwords) {
+        funcs[nfuncs++] = func;
+    }
+
+    qsort(funcs, nfuncs, sizeof(hackasm_func), cmp_funcs);
+
+    result->funcs = funcs;
+    result->nfuncs = nfuncs;
+}
+
+/* gathers up every chunk's labels to measure functions by */
+static bool report_funcs(const assembly* const as, const size_t ninstrs,
+                         hackasm_result* const result) {
+    size_t nlabels = 0;
+    for (size_t k = 0; k < as->nchunks; ++k) {
+        nlabels += as->chunks[k].labels.len;
+    }
+
+    hackasm_func* const funcs = malloc((nlabels + 1) * sizeof(hackasm_func));
+    if (!funcs) {
+        return false;
+    }
+
+    size_t n = 0;
+    for (size_t k = 0; k < as->nchunks; ++k) {
+        const chunk* const ch = &as->chunks[k];
+
+        for (size_t i = 0; i < ch->labels.len; ++i) {
+            const label_def* const label = &ch->labels.labels[i];
+            funcs[n++] = (hackasm_func){as->src + label->symbol.off,
+                                        label->symbol.len,
+                                        ch->instr_base + label->idx, 0};
+        }
+    }
+
+    measure_funcs(funcs, nlabels, ninstrs, result);
+    return true;
+}
+
+/* update symbol table - labels go in in source order, so the first definition
+ * of a label is the one that counts */
+static void define_labels(const assembly* const as,
+                          hackasm_result* const result) {
+    for (size_t k = 0; k < as->nchunks; ++k) {
+        const chunk* const ch = &as->chunks[k];
+
+        for (size_t i = 0; i < ch->labels.len; ++i) {
+            const label_def* const label = &ch->labels.labels[i];
+            const char* const name = as->src + label->symbol.off;
+            /* used to count instructions in program (only wraps when there
+             * is no ROM limit) */
+            const uint16_t pc = (uint16_t)(ch->instr_base + label->idx);
+
+            if (sym_tbl_insert(as->tbl, name, label->symbol.len, pc)) {
+                result->symbols[result->nsymbols++] = (hackasm_symbol){
+                    HACKASM_LABEL, name, label->symbol.len, pc};
+            }
+        }
+    }
+}
+
+double hackasm_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* records the (only) diagnostic of a failed assembly */
+static bool fail(hackasm_result* const result, const hackasm_diag diag) {
+    result->diags = malloc(sizeof(hackasm_diag));
+    if (result->diags) {
+        result->diags[0] = diag;
+        result->ndiags = 1;
+    }
+
+    return false;
+}
+
+bool hackasm_assemble(const char* const src, const size_t len,
+                      const hackasm_opts* const opts,
+                      hackasm_result* const result) {
+    thread_pool* const pool = (opts ? opts->pool : NULL);
+    const bool no_rom_limit = (opts ? opts->no_rom_limit : false);
+    const bool relocatable = (opts ? opts->relocatable : false);
+    const bool record_lines = (opts ? opts->record_lines : false);
+    unsigned optimize = (opts ? opts->optimize : 0);
+    bool ok = true;
+
+    /* code in an object may be reached from anywhere, none of it is dead */
+    if (relocatable && optimize > 1) {
+        optimize = 1;
+    }
+
+    *result = EMPTY_RESULT;
+
+    /* instructions refer back into the source by 32-bit offsets */
+    if (len > UINT32_MAX) {
+        return fail(result, (hackasm_diag){HACKASM_SRC_SIZE, 0, NULL, 0});
+    }
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * PARSING
+     * split the source into line-aligned chunks (just one unless assembling
+     * on several threads), parse every chunk in parallel
+     * enqueue A- and C-instructions, remember L-instructions for later
+     * optimize the whole program, if asked to
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    hackasm_times* const times = &result->times;
+    hackasm_stats* const stats = &result->stats;
+    double start = hackasm_now();
+
+    assembly as = {src, len, NULL, 0, NULL, NULL, NULL};
+
+    as.tbl = sym_tbl_alloc();
+    if (!as.tbl) {
+        ok = fail(result, OUT_OF_MEMORY);
+        goto EXIT;
+    }
+
+    as.nchunks = len / MIN_CHUNK_LEN;
+    if (as.nchunks > pool_size(pool) * CHUNKS_PER_THREAD) {
+        as.nchunks = pool_size(pool) * CHUNKS_PER_THREAD;
+    }
+    /* the optimizer needs to see the whole program at once */
+    if (pool_size(pool) == 1 || !as.nchunks || optimize) {
+        as.nchunks = 1;
+    }
+
+    as.chunks = calloc(as.nchunks, sizeof(chunk));
+    if (!as.chunks) {
+        ok = fail(result, OUT_OF_MEMORY);
+        goto EXIT;
+    }
+    ++stats->nallocs;
+
+    /* chunks end just after the first endline past an even split */
+    for (size_t k = 0, begin = 0; k < as.nchunks; ++k) {
+        size_t end = len * (k + 1) / as.nchunks;
+        if (end < begin) {
+            end = begin;
+        }
+
+        const char* eol =
+            (end < len ? memchr(src + end, '\n', len - end) : NULL);
+        end = (eol ? (size_t)(eol - src) + 1 : len);
+
+        as.chunks[k].begin = begin;
+        as.chunks[k].end = end;
+        begin = end;
+    }
+
+    pool_for(pool, as.nchunks, parse_chunk, &as);
+
+    for (size_t k = 0; k < as.nchunks; ++k) {
+        stats->nlines += as.chunks[k].nlines;
+        stats->ninstrs += as.chunks[k].prog.len;
+        stats->nlabels += as.chunks[k].labels.len;
+    }
+
+    times->parse = hackasm_now() - start;
+    start = hackasm_now();
+
+    /* running out of memory here only leaves the program less optimized */
+    if (optimize && !as.chunks[0].failed) {
+        chunk* const ch = &as.chunks[0];
+
+        optimize_peephole(&ch->prog, &ch->labels, src, relocatable);
+
+        /* with fewer labels around, the peephole pass may see more */
+        if (optimize >= 2) {
+            optimize_dead_code(&ch->prog, &ch->labels, src);
+            optimize_peephole(&ch->prog, &ch->labels, src, relocatable);
+        }
+    }
+
+    times->optimize = hackasm_now() - start;
+    start = hackasm_now();
+
+    /* number every chunk's lines and instructions from where the last left
+     * off, reporting the first error in the source (if there is one) */
+    uint32_t nlines = 0;
+    size_t ninstrs = 0;
+
+    for (size_t k = 0; k < as.nchunks; ++k) {
+        chunk* const ch = &as.chunks[k];
+
+        if (ch->failed) {
+            if (ch->err.kind == HACKASM_SYNTAX) {
+                ch->err.line += nlines;
+            }
+            ok = fail(result, ch->err);
+            goto EXIT;
+        }
+
+        ch->line_base = nlines;
+        ch->instr_base = ninstrs;
+
+        nlines += ch->nlines;
+        ninstrs += ch->prog.len; /* only instructions generate code */
+    }
+
+    /* addresses are only 15 bits, code past the end of the ROM could never
+     * be jumped to (or even loaded) */
+    if (ninstrs > HACKASM_ROM_WORDS && !no_rom_limit) {
+        ok = fail(result, (report_funcs(&as, ninstrs, result)
+                               ? (hackasm_diag){HACKASM_ROM_SIZE, 0, NULL, 0}
+                               : OUT_OF_MEMORY));
+        goto EXIT;
+    }
+
+    size_t nlabels = 0;
+    for (size_t k = 0; k < as.nchunks; ++k) {
+        nlabels += as.chunks[k].labels.len;
+    }
+
+    /* room for every label, plus at most one variable per A-instruction -
+     * trimmed down to size at the end */
+    result->symbols = malloc((nlabels + ninstrs + 1) * sizeof(hackasm_symbol));
+    if (!result->symbols) {
+        ok = fail(result, OUT_OF_MEMORY);
+        goto EXIT;
+    }
+    ++stats->nallocs;
+
+    /* objects leave labels for the linker to resolve, like variables */
+    if (!relocatable) {
+        define_labels(&as, result);
+    } else {
+        result->refs = malloc((ninstrs + 1) * sizeof(hackasm_ref));
+        if (!result->refs) {
+            ok = fail(result, OUT_OF_MEMORY);
+            goto EXIT;
+        }
+        ++stats->nallocs;
+    }
+
+    times->resolve = hackasm_now() - start;
+    start = hackasm_now();
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * TRANSLATION
+     * iterate trough every chunk's instruction queue in parallel
+     * look up references to labels and predefined symbols in the symbol table
+     * pass resolved instruction fields to translator for binary translation
+     * OR encoded fields together to form complete machine word
+     * then number variables in order of first use, sequentially
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    /* the encoded program, one machine word per instruction */
+    as.rom = malloc((ninstrs ? ninstrs : 1) * sizeof(uint16_t));
+    if (!as.rom) {
+        ok = fail(result, OUT_OF_MEMORY);
+        goto EXIT;
+    }
+    ++stats->nallocs;
+
+    if (record_lines) {
+        as.lines = malloc((ninstrs ? ninstrs : 1) * sizeof(uint32_t));
+        if (!as.lines) {
+            ok = fail(result, OUT_OF_MEMORY);
+            goto EXIT;
+        }
+        ++stats->nallocs;
+    }
+
+    pool_for(pool, as.nchunks, encode_chunk, &as);
+
+    times->encode = hackasm_now() - start;
+    start = hackasm_now();
+
+    /* labels still count for what the object exports */
+    if (relocatable) {
+        define_labels(&as, result);
+    }
+
+    uint16_t nvars = 16; /* used to count variables in program */
+
+    for (size_t k = 0; k < as.nchunks; ++k) {
+        chunk* const ch = &as.chunks[k];
+
+        if (ch->failed) {
+            ok = fail(result, ch->err);
+            goto EXIT;
+        }
+
+        for (size_t i = 0; i < ch->npending; ++i) {
+            instruction* const instr = &ch->prog.instrs[ch->pending[i]];
+            const char* const name = src + instr->symbol.off;
+            const uint16_t first_var = nvars;
+
+            if (relocatable) {
+                result->refs[result->nrefs++] = (hackasm_ref){
+                    ch->instr_base + ch->pending[i], name, instr->symbol.len};
+                as.rom[ch->instr_base + ch->pending[i]] = 0;
+                continue;
+            }
+
+            if (!resolve_reference(instr, src, as.tbl, &nvars)) {
+                ok = fail(result,
+                          (hackasm_diag){HACKASM_REFERENCE, instr->line_number,
+                                         name, instr->symbol.len});
+                goto EXIT;
+            }
+
+            /* a new variable was just numbered */
+            if (nvars != first_var) {
+                ++stats->nvars;
+                result->symbols[result->nsymbols++] = (hackasm_symbol){
+                    HACKASM_VARIABLE, name, instr->symbol.len, instr->addr};
+            }
+
+            as.rom[ch->instr_base + ch->pending[i]] = instr->addr;
+        }
+    }
+
+    times->resolve += hackasm_now() - start;
+
+    /* hand the program over to the caller */
+    result->rom = as.rom;
+    result->nwords = ninstrs;
+    result->lines = as.lines;
+    as.rom = NULL;
+    as.lines = NULL;
+
+    hackasm_symbol* symbols = realloc(
+        result->symbols, (result->nsymbols + 1) * sizeof(hackasm_symbol));
+    if (symbols) {
+        result->symbols = symbols;
+        ++stats->nallocs;
+    }
+
+EXIT:
+    free(as.rom);
+    free(as.lines);
+
+    /* count up what the chunks and the table allocated before they go */
+    for (size_t k = 0; as.chunks && k < as.nchunks; ++k) {
+        stats->nallocs += as.chunks[k].prog.nallocs +
+                          as.chunks[k].labels.nallocs +
+                          (as.chunks[k].pending != NULL);
+    }
+
+    sym_tbl_stats tbl_stats;
+    sym_tbl_get_stats(as.tbl, &tbl_stats);
+
+    stats->tbl_len = tbl_stats.len;
+    stats->tbl_cap = tbl_stats.cap;
+    stats->tbl_longest_probe = tbl_stats.longest_probe;
+    stats->nallocs += tbl_stats.nallocs + (result->diags != NULL) +
+                      (result->funcs != NULL);
+
+    for (size_t k = 0; as.chunks && k < as.nchunks; ++k) {
+        instr_array_free(&as.chunks[k].prog);
+        label_array_free(&as.chunks[k].labels);
+        free(as.chunks[k].pending);
+    }
+    free(as.chunks);
+
+    sym_tbl_free(as.tbl);
+
+    return ok;
+}
+
+void hackasm_result_free(hackasm_result* const result) {
+    if (!result) {
+        return;
+    }
+
+    free(result->rom);
+    free(result->lines);
+    free(result->symbols);
+    free(result->refs);
+    free(result->diags);
+    free(result->funcs);
+
+    *result = EMPTY_RESULT;
+}
+
+bool hackasm_link(const char* const* const objs, const size_t* const lens,
+                  const size_t nobjs, const hackasm_opts* const opts,
+                  hackasm_result* const result) {
+    const bool no_rom_limit = (opts ? opts->no_rom_limit : false);
+    bool ok = true;
+
+    *result = EMPTY_RESULT;
+
+    hackasm_times* const times = &result->times;
+    hackasm_stats* const stats = &result->stats;
+    double start = hackasm_now();
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * READING
+     * check and decode every object, lay their code out back to back in
+     * link order
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    object* const parsed = calloc(nobjs + 1, sizeof(object));
+    size_t* const bases = malloc((nobjs + 1) * sizeof(size_t));
+    sym_tbl* const tbl = sym_tbl_alloc();
+    uint16_t* rom = NULL;
+
+    if (!parsed || !bases || !tbl) {
+        ok = fail(result, OUT_OF_MEMORY);
+        goto EXIT;
+    }
+    stats->nallocs += 2;
+
+    size_t nwords = 0;
+    size_t nlabels = 0;
+    size_t nrefs = 0;
+
+    for (size_t k = 0; k < nobjs; ++k) {
+        if (!object_read(objs[k], lens[k], &parsed[k])) {
+            ok = fail(result, (hackasm_diag){HACKASM_CORRUPT, (uint32_t)k,
+                                             NULL, 0});
+            goto EXIT;
+        }
+
+        bases[k] = nwords;
+        nwords += parsed[k].ncode;
+        nlabels += parsed[k].nlabels;
+        nrefs += parsed[k].nrefs;
+    }
+
+    stats->ninstrs = nwords;
+    stats->nlabels = nlabels;
+
+    times->parse = hackasm_now() - start;
+    start = hackasm_now();
+
+    if (nwords > HACKASM_ROM_WORDS && !no_rom_limit) {
+        hackasm_func* const funcs =
+            malloc((nlabels + 1) * sizeof(hackasm_func));
+        if (!funcs) {
+            ok = fail(result, OUT_OF_MEMORY);
+            goto EXIT;
+        }
+
+        size_t n = 0;
+        for (size_t k = 0; k < nobjs; ++k) {
+            for (size_t i = 0; i < parsed[k].nlabels; ++i) {
+                const obj_symbol* const label = &parsed[k].labels[i];
+                funcs[n++] = (hackasm_func){label->name, label->len,
+                                            bases[k] + label->address, 0};
+            }
+        }
+
+        measure_funcs(funcs, nlabels, nwords, result);
+        ok = fail(result, (hackasm_diag){HACKASM_ROM_SIZE, 0, NULL, 0});
+        goto EXIT;
+    }
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * RESOLUTION
+     * define every label, the first definition in link order counting
+     * fill in every reference, in link order, numbering variables as they
+     * come up - just as assembling the sources in one go would
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    result->symbols = malloc((nlabels + nrefs + 1) * sizeof(hackasm_symbol));
+    rom = malloc((nwords ? nwords : 1) * sizeof(uint16_t));
+    if (!result->symbols || !rom) {
+        ok = fail(result, OUT_OF_MEMORY);
+        goto EXIT;
+    }
+    stats->nallocs += 2;
+
+    for (size_t k = 0; k < nobjs; ++k) {
+        for (size_t i = 0; i < parsed[k].nlabels; ++i) {
+            const obj_symbol* const label = &parsed[k].labels[i];
+            const uint16_t pc = (uint16_t)(bases[k] + label->address);
+
+            if (sym_tbl_insert(tbl, label->name, label->len, pc)) {
+                result->symbols[result->nsymbols++] = (hackasm_symbol){
+                    HACKASM_LABEL, label->name, label->len, pc};
+            }
+        }
+
+        memcpy(rom + bases[k], parsed[k].code,
+               parsed[k].ncode * sizeof(uint16_t));
+    }
+
+    uint16_t nvars = 16; /* used to count variables in program */
+
+    for (size_t k = 0; k < nobjs; ++k) {
+        for (size_t i = 0; i < parsed[k].nrefs; ++i) {
+            const obj_ref* const ref = &parsed[k].refs[i];
+            const obj_symbol* const sym = &parsed[k].symbols[ref->symbol];
+
+            uint16_t addr = sym_tbl_lookup(tbl, sym->name, sym->len);
+
+            /* not a label anywhere, so it must be a variable */
+            if (addr == SYM_TBL_NPOS) {
+                if (!sym_tbl_insert(tbl, sym->name, sym->len, nvars)) {
+                    ok = fail(result, OUT_OF_MEMORY);
+                    goto EXIT;
+                }
+
+                addr = nvars++;
+                ++stats->nvars;
+                result->symbols[result->nsymbols++] = (hackasm_symbol){
+                    HACKASM_VARIABLE, sym->name, sym->len, addr};
+            }
+
+            rom[bases[k] + ref->word] = addr;
+        }
+    }
+
+    times->resolve = hackasm_now() - start;
+
+    /* hand the program over to the caller */
+    result->rom = rom;
+    result->nwords = nwords;
+    rom = NULL;
+
+EXIT:
+    free(rom);
+
+    for (size_t k = 0; parsed && k < nobjs; ++k) {
+        stats->nallocs += (size_t)((parsed[k].code != NULL) +
+                                   (parsed[k].labels != NULL) +
+                                   (parsed[k].symbols != NULL) +
+                                   (parsed[k].refs != NULL));
+        object_free(&parsed[k]);
+    }
+    free(parsed);
+    free(bases);
+
+    sym_tbl_stats tbl_stats;
+    sym_tbl_get_stats(tbl, &tbl_stats);
+
+    stats->tbl_len = tbl_stats.len;
+    stats->tbl_cap = tbl_stats.cap;
+    stats->tbl_longest_probe = tbl_stats.longest_probe;
+    stats->nallocs += tbl_stats.nallocs + (result->diags != NULL) +
+                      (result->funcs != NULL);
+
+    sym_tbl_free(tbl);
+
+    return ok;
+}
+
+/* a slice of the ROM to render as text */
+typedef struct render_job {
+    const uint16_t* rom;
+    size_t nwords;
+    size_t nslices;
+    char* text;
+} render_job;
+
+static void render_slice(void* ctx, size_t idx) {
+    const render_job* const job = ctx;
+    const size_t begin = job->nwords * idx / job->nslices;
+    const size_t end = job->nwords * (idx + 1) / job->nslices;
+
+    /* every word renders to the same length, so slices know where their text
+     * goes */
+    translate_render(job->rom + begin, end - begin,
+                     job->text + begin * TRANSLATE_LINE_LEN);
+}
+
+/* output extension for each hackasm_format */
+static const char* const FORMAT_EXTS[] = {".hack", ".rom", ".hobj", ".sym"};
+
+const char* hackasm_format_ext(const hackasm_format format) {
+    return FORMAT_EXTS[format];
+}
+
+char* hackasm_render(const hackasm_result* const result,
+                     const hackasm_format format,
+                     const hackasm_opts* const opts, size_t* const len) {
+    thread_pool* const pool = (opts ? opts->pool : NULL);
+    const size_t nwords = result->nwords;
+    char* out = NULL;
+
+    if (format == HACKASM_OBJECT) {
+        return object_render(result, len);
+    }
+
+    if (format == HACKASM_SYMBOLS) {
+        return symmap_render(result, len);
+    }
+
+    if (format == HACKASM_ROM) {
+        out = malloc(ROM_HEADER_LEN + nwords * sizeof(uint16_t));
+        if (out) {
+            *len = translate_render_rom(result->rom, nwords, out);
+        }
+        return out;
+    }
+
+    out = malloc((nwords ? nwords : 1) * TRANSLATE_LINE_LEN);
+    if (!out) {
+        return NULL;
+    }
+
+    render_job job = {result->rom, nwords, 1, out};
+
+    /* same split as for parsing, just by words instead of bytes */
+    job.nslices = nwords * TRANSLATE_LINE_LEN / MIN_CHUNK_LEN;
+    if (job.nslices > pool_size(pool) * CHUNKS_PER_THREAD) {
+        job.nslices = pool_size(pool) * CHUNKS_PER_THREAD;
+    }
+    if (pool_size(pool) == 1 || !job.nslices) {
+        job.nslices = 1;
+    }
+
+    pool_for(pool, job.nslices, render_slice, &job);
+
+    *len = nwords * TRANSLATE_LINE_LEN;
+    return out;
+}
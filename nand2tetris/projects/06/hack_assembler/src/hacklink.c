@@ -0,0 +1,195 @@
+/**
+ * @file hacklink.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This program links object files written by
+ * "Assembler -c" into a whole program, so that only the sources that changed
+ * need assembling again.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool, true, false
+#include <stdio.h>   // for fprintf, stderr, FILE, fopen, fwrite, fclose
+#include <stdlib.h>  // for EXIT_FAILURE, EXIT_SUCCESS, malloc, free
+#include <string.h>  // for strcmp, strrchr, strlen, memcpy
+
+#include "cli.h"
+#include "hackasm.h"
+
+/* path standing in for stdout */
+static const char* const STDIO_PATH = "-";
+
+/* the first object's path, with its extension swapped for ext */
+static char* default_output(const char* const path, const char* const ext) {
+    const char* const slash = strrchr(path, '/');
+    const char* const dot = strrchr(path, '.');
+    const size_t stem_len =
+        (dot && (!slash || dot > slash) ? (size_t)(dot - path) : strlen(path));
+
+    char* out = malloc(stem_len + strlen(ext) + 1);
+    if (out) {
+        memcpy(out, path, stem_len);
+        strcpy(out + stem_len, ext);
+    }
+
+    return out;
+}
+
+/* reports why linking failed */
+static void print_diags(const hackasm_result* const result,
+                        char* const* const paths) {
+    for (size_t i = 0; i < result->ndiags; ++i) {
+        const hackasm_diag* const diag = &result->diags[i];
+
+        switch (diag->kind) {
+        case HACKASM_CORRUPT:
+            fprintf(stderr, "[ERROR] Corrupt object file \"%s\"\n",
+                    paths[diag->line]);
+            break;
+        case HACKASM_ROM_SIZE:
+            fprintf(stderr,
+                    "[ERROR] Linked program does not fit in ROM (%d words)\n",
+                    HACKASM_ROM_WORDS);
+            break;
+        case HACKASM_RESOURCES:
+            fprintf(stderr, "[ERROR] Out of memory linking\n");
+            break;
+        default: /* only come up when assembling */
+            break;
+        }
+    }
+
+    if (result->nfuncs) {
+        cli_print_funcs(result);
+    }
+}
+
+int main(int argc, char** argv) {
+    int EXIT_STATUS = EXIT_SUCCESS;
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * OPTIONS
+     * -b, --binary      write a binary ROM image (.rom) instead of .hack text
+     * -o <path>         where to write the program ("-" for stdout; def. the
+     *                   first object, with its extension changed)
+     * --no-rom-limit    link programs too large for the ROM anyway
+     * then the object files, in link order
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    hackasm_format format = HACKASM_TEXT;
+    hackasm_opts opts = {NULL, 0, false, false, false};
+    const char* out_path = NULL;
+    int first = 1;
+
+    for (; first < argc && argv[first][0] == '-'; ++first) {
+        if (!strcmp(argv[first], "-b") || !strcmp(argv[first], "--binary")) {
+            format = HACKASM_ROM;
+        } else if (!strcmp(argv[first], "--no-rom-limit")) {
+            opts.no_rom_limit = true;
+        } else if (!strcmp(argv[first], "-o") && first + 1 < argc) {
+            out_path = argv[++first];
+        } else {
+            break;
+        }
+    }
+
+    if (first >= argc || argv[first][0] == '-') {
+        fprintf(stderr,
+                "[ERROR] Usage: %s [-b|--binary] [-o <output>|-] "
+                "[--no-rom-limit] <path to object>.hobj...\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * LINKING
+     * read every object into memory, hand them all over to the library
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    char* const* const paths = argv + first;
+    const size_t nobjs = (size_t)(argc - first);
+
+    char** objs = calloc(nobjs, sizeof(char*));
+    size_t* lens = calloc(nobjs, sizeof(size_t));
+    hackasm_result result = {
+        NULL, 0, NULL, NULL, 0, NULL, 0, NULL, 0, NULL, 0, {0, 0, 0, 0}, {0}};
+    char* default_path = NULL;
+    char* out = NULL;
+
+    if (!objs || !lens) {
+        fprintf(stderr, "[ERROR] Out of memory\n");
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
+    for (size_t i = 0; i < nobjs; ++i) {
+        if (!(objs[i] = cli_slurp(paths[i], &lens[i]))) {
+            fprintf(stderr, "[ERROR] Failed to read object file \"%s\"\n",
+                    paths[i]);
+            EXIT_STATUS = EXIT_FAILURE;
+            goto EXIT;
+        }
+    }
+
+    if (!hackasm_link((const char* const*)objs, lens, nobjs, &opts,
+                      &result)) {
+        print_diags(&result, paths);
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
+    /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     * OUTPUT
+     * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+    size_t out_len = 0;
+    out = hackasm_render(&result, format, &opts, &out_len);
+    if (!out) {
+        fprintf(stderr, "[ERROR] Out of memory rendering program\n");
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
+    if (!out_path) {
+        out_path = default_path =
+            default_output(paths[0], hackasm_format_ext(format));
+    }
+
+    FILE* const fout = (out_path && !strcmp(out_path, STDIO_PATH)
+                            ? stdout
+                            : (out_path ? fopen(out_path, "wb") : NULL));
+    bool written = (fout && fwrite(out, 1, out_len, fout) == out_len);
+
+    /* a full disk shows up here, or only once the output is flushed */
+    if (fout == stdout) {
+        written = !fflush(stdout) && written;
+    } else if (fout) {
+        written = !fclose(fout) && written;
+    }
+
+    if (!written) {
+        fprintf(stderr, "[ERROR] Failed to write output file \"%s\"\n",
+                (out_path ? out_path : ""));
+        EXIT_STATUS = EXIT_FAILURE;
+    }
+
+EXIT:
+    free(out);
+    free(default_path);
+
+    /* the result points into the objects, so it goes first */
+    hackasm_result_free(&result);
+
+    for (size_t i = 0; objs && i < nobjs; ++i) {
+        free(objs[i]);
+    }
+    free(objs);
+    free(lens);
+
+    return EXIT_STATUS;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file object.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module writes and reads relocatable object
+ * files: one piece of a program, assembled on its own, with every reference
+ * to a label or variable left for the linker to fill in.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool, true, false
+#include <stdint.h>  // for uint16_t, uint32_t
+#include <stdlib.h>  // for malloc, free
+#include <string.h>  // for memcpy, memcmp
+
+#include "object.h"
+#include "sym_tbl.h"
+#include "translator.h"
+
+/* bytes taken by each entry in the label, symbol and reference tables */
+static const size_t LABEL_LEN = 12;
+static const size_t SYMBOL_LEN = 8;
+static const size_t REF_LEN = 8;
+
+static uint16_t get_le16(const unsigned char* const in) {
+    return (uint16_t)(in[0] | in[1] << 8);
+}
+
+static uint32_t get_le32(const unsigned char* const in) {
+    return (uint32_t)get_le16(in) | (uint32_t)get_le16(in + 2) << 16;
+}
+
+char* object_render(const hackasm_result* const result, size_t* const len) {
+    char* out = NULL;
+
+    /* every symbol goes in the table once, however often it's referred to */
+    sym_tbl* const names = sym_tbl_alloc_empty(); /* symbol -> its index */
+    uint32_t* const ref_syms = malloc((result->nrefs + 1) * sizeof(uint32_t));
+    size_t* const firsts = malloc((result->nrefs + 1) * sizeof(size_t));
+
+    if (!names || !ref_syms || !firsts) {
+        goto EXIT;
+    }
+
+    size_t nlabels = 0;
+    size_t strs_len = 0;
+
+    for (size_t i = 0; i < result->nsymbols; ++i) {
+        if (result->symbols[i].kind == HACKASM_LABEL) {
+            ++nlabels;
+            strs_len += result->symbols[i].len;
+        }
+    }
+
+    size_t nsyms = 0;
+
+    for (size_t i = 0; i < result->nrefs; ++i) {
+        const hackasm_ref* const ref = &result->refs[i];
+        uint16_t idx = sym_tbl_lookup(names, ref->name, ref->len);
+
+        if (idx == SYM_TBL_NPOS) {
+            /* symbol indices have to fit in the table too */
+            if (nsyms + 1 >= SYM_TBL_NPOS ||
+                !sym_tbl_insert(names, ref->name, ref->len, (uint16_t)nsyms)) {
+                goto EXIT;
+            }
+
+            idx = (uint16_t)nsyms;
+            firsts[nsyms++] = i;
+            strs_len += ref->len;
+        }
+
+        ref_syms[i] = idx;
+    }
+
+    const size_t nwords = result->nwords;
+    *len = OBJ_HEADER_LEN + 2 * nwords + LABEL_LEN * nlabels +
+           SYMBOL_LEN * nsyms + REF_LEN * result->nrefs + strs_len;
+
+    out = malloc(*len);
+    if (!out) {
+        goto EXIT;
+    }
+
+    unsigned char* const header = (unsigned char*)out;
+    unsigned char* const body = header + OBJ_HEADER_LEN;
+    unsigned char* p = body;
+
+    /* the string table goes last, names are placed as they come up */
+    char* const strs = out + *len - strs_len;
+    uint32_t strs_off = 0;
+
+    for (size_t i = 0; i < nwords; ++i, p += 2) {
+        translate_put_le16(p, result->rom[i]);
+    }
+
+    for (size_t i = 0; i < result->nsymbols; ++i) {
+        const hackasm_symbol* const sym = &result->symbols[i];
+        if (sym->kind != HACKASM_LABEL) {
+            continue;
+        }
+
+        translate_put_le32(p, strs_off);
+        translate_put_le32(p + 4, (uint32_t)sym->len);
+        translate_put_le32(p + 8, sym->address);
+        p += LABEL_LEN;
+
+        memcpy(strs + strs_off, sym->name, sym->len);
+        strs_off += (uint32_t)sym->len;
+    }
+
+    for (size_t i = 0; i < nsyms; ++i, p += SYMBOL_LEN) {
+        const hackasm_ref* const ref = &result->refs[firsts[i]];
+
+        translate_put_le32(p, strs_off);
+        translate_put_le32(p + 4, (uint32_t)ref->len);
+
+        memcpy(strs + strs_off, ref->name, ref->len);
+        strs_off += (uint32_t)ref->len;
+    }
+
+    for (size_t i = 0; i < result->nrefs; ++i, p += REF_LEN) {
+        translate_put_le32(p, (uint32_t)result->refs[i].word);
+        translate_put_le32(p + 4, ref_syms[i]);
+    }
+
+    memcpy(header, OBJ_MAGIC, 4);
+    translate_put_le16(header + 4, OBJ_VERSION);
+    translate_put_le16(header + 6, OBJ_HEADER_LEN);
+    translate_put_le32(header + 8, (uint32_t)nwords);
+    translate_put_le32(header + 12, (uint32_t)nlabels);
+    translate_put_le32(header + 16, (uint32_t)nsyms);
+    translate_put_le32(header + 20, (uint32_t)result->nrefs);
+    translate_put_le32(header + 24, (uint32_t)strs_len);
+    translate_put_le32(header + 28,
+                       translate_crc32(body, *len - OBJ_HEADER_LEN));
+
+EXIT:
+    free(firsts);
+    free(ref_syms);
+    sym_tbl_free(names);
+
+    return out;
+}
+
+/* reads a name, false if it runs past the end of the string table */
+static bool read_name(const unsigned char* const in, const char* const strs,
+                      const size_t strs_len, obj_symbol* const sym) {
+    const size_t off = get_le32(in);
+    sym->len = get_le32(in + 4);
+    sym->name = strs + off;
+
+    /* names are never empty, as in the symbol table */
+    return sym->len && off <= strs_len && sym->len <= strs_len - off;
+}
+
+bool object_read(const char* const data, const size_t len, object* const obj) {
+    const unsigned char* const header = (const unsigned char*)data;
+    *obj = (object){NULL, 0, NULL, 0, NULL, 0, NULL, 0};
+
+    if (len < OBJ_HEADER_LEN || memcmp(header, OBJ_MAGIC, 4) ||
+        get_le16(header + 4) != OBJ_VERSION ||
+        get_le16(header + 6) != OBJ_HEADER_LEN) {
+        return false;
+    }
+
+    const size_t ncode = get_le32(header + 8);
+    const size_t nlabels = get_le32(header + 12);
+    const size_t nsymbols = get_le32(header + 16);
+    const size_t nrefs = get_le32(header + 20);
+    const size_t strs_len = get_le32(header + 24);
+
+    /* the counts are 32 bits, so these sums can't overflow */
+    const size_t body_len = 2 * ncode + LABEL_LEN * nlabels +
+                            SYMBOL_LEN * nsymbols + REF_LEN * nrefs + strs_len;
+    const unsigned char* const body = header + OBJ_HEADER_LEN;
+
+    if (len - OBJ_HEADER_LEN != body_len ||
+        translate_crc32(body, body_len) != get_le32(header + 28)) {
+        return false;
+    }
+
+    obj->code = malloc((ncode + 1) * sizeof(uint16_t));
+    obj->labels = malloc((nlabels + 1) * sizeof(obj_symbol));
+    obj->symbols = malloc((nsymbols + 1) * sizeof(obj_symbol));
+    obj->refs = malloc((nrefs + 1) * sizeof(obj_ref));
+
+    if (!obj->code || !obj->labels || !obj->symbols || !obj->refs) {
+        return false;
+    }
+
+    const char* const strs = data + len - strs_len;
+    const unsigned char* p = body;
+
+    for (; obj->ncode < ncode; ++obj->ncode, p += 2) {
+        obj->code[obj->ncode] = get_le16(p);
+    }
+
+    for (; obj->nlabels < nlabels; ++obj->nlabels, p += LABEL_LEN) {
+        obj_symbol* const label = &obj->labels[obj->nlabels];
+
+        if (!read_name(p, strs, strs_len, label)) {
+            return false;
+        }
+
+        /* a label may mark the end of the code, but not go past it */
+        label->address = get_le32(p + 8);
+        if (label->address > ncode) {
+            return false;
+        }
+    }
+
+    for (; obj->nsymbols < nsymbols; ++obj->nsymbols, p += SYMBOL_LEN) {
+        obj_symbol* const sym = &obj->symbols[obj->nsymbols];
+
+        if (!read_name(p, strs, strs_len, sym)) {
+            return false;
+        }
+        sym->address = 0;
+    }
+
+    for (; obj->nrefs < nrefs; ++obj->nrefs, p += REF_LEN) {
+        obj_ref* const ref = &obj->refs[obj->nrefs];
+
+        ref->word = get_le32(p);
+        ref->symbol = get_le32(p + 4);
+
+        if (ref->word >= ncode || ref->symbol >= nsymbols) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void object_free(object* const obj) {
+    if (!obj) {
+        return;
+    }
+
+    free(obj->code);
+    free(obj->labels);
+    free(obj->symbols);
+    free(obj->refs);
+
+    *obj = (object){NULL, 0, NULL, 0, NULL, 0, NULL, 0};
+}
@@ -0,0 +1,511 @@
+/**
+ * @file optimizer.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module rewrites a parsed program, before any
+ * addresses are assigned, into an equivalent one that is smaller and faster.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> // for bool, true, false
+#include <stdint.h>  // for uint16_t, uint32_t
+#include <stdlib.h>  // for calloc, malloc, free
+#include <string.h>  // for memchr, memcmp, memset, strlen
+
+#include "optimizer.h"
+#include "parser.h"
+#include "sym_tbl.h"
+
+/* every optimization only ever removes code, so this is just a safety net */
+static const unsigned MAX_ROUNDS = 16;
+
+/* the program being optimized, and what we know about its labels */
+typedef struct program {
+    instr_array* prog;
+    label_array* labels;
+    const char* src;
+
+    sym_tbl* predefined; /* names that can never be labels */
+    sym_tbl* targets;    /* label -> index of the instruction it marks */
+    bool* labeled;       /* instruction i is marked by some label */
+    bool* pinned;        /* instruction i may be jumped to at a computed
+                            offset from a label, so must stay where it is */
+    bool* dead;          /* instruction i is to be removed */
+    uint32_t* remap;     /* old index -> new index, while compacting */
+} program;
+
+static bool field_is(const char* const src, const src_span field,
+                     const char* const text) {
+    return field.len == strlen(text) &&
+           !memcmp(src + field.off, text, field.len);
+}
+
+static bool field_has(const char* const src, const src_span field,
+                      const char c) {
+    return memchr(src + field.off, c, field.len) != NULL;
+}
+
+/* C-instruction that may jump */
+static bool is_jump(const instruction* const instr) {
+    return instr->type == C_INSTR && instr->jump.len;
+}
+
+/* C-instruction that always jumps */
+static bool is_goto(const program* const pg, const instruction* const instr) {
+    return instr->type == C_INSTR && field_is(pg->src, instr->jump, "JMP");
+}
+
+static bool writes_a(const program* const pg, const instruction* const instr) {
+    return instr->type == C_INSTR && field_has(pg->src, instr->dest, 'A');
+}
+
+/* two A-instructions load the same value, as far as we can tell before any
+ * addresses are known */
+static bool same_load(const program* const pg, const instruction* const a,
+                      const instruction* const b) {
+    if (a->resolved || b->resolved) {
+        return a->resolved && b->resolved && a->addr == b->addr;
+    }
+
+    return a->symbol.len == b->symbol.len &&
+           !memcmp(pg->src + a->symbol.off, pg->src + b->symbol.off,
+                   a->symbol.len);
+}
+
+/* index of the instruction an A-instruction refers to, SYM_TBL_NPOS if it
+ * doesn't load a label */
+static uint16_t target_of(const program* const pg,
+                          const instruction* const instr) {
+    if (instr->type != A_INSTR || instr->resolved) {
+        return SYM_TBL_NPOS;
+    }
+
+    return sym_tbl_lookup(pg->targets, pg->src + instr->symbol.off,
+                          instr->symbol.len);
+}
+
+/* keeps a label's code, up to the next label, exactly as it is */
+static void pin(program* const pg, const uint16_t t) {
+    for (size_t k = t; k < pg->prog->len && (k == t || !pg->labeled[k]);
+         ++k) {
+        pg->pinned[k] = true;
+    }
+}
+
+/* finds labels whose address is used as a number, not only jumped to or
+ * copied - the base of a jump table, say: @TABLE / D=A / @R0 / D=D+M / A=D /
+ * 0;JMP - since the code after them has to stay where it is. Only arithmetic
+ * on A right after the label is loaded, or on D after the address was copied
+ * there, is caught */
+static void pin_tables(program* const pg) {
+    const instruction* const instrs = pg->prog->instrs;
+    uint16_t in_d = SYM_TBL_NPOS; /* label whose address D holds */
+
+    memset(pg->pinned, 0, (pg->prog->len + 1) * sizeof(bool));
+
+    for (size_t i = 0; i < pg->prog->len; ++i) {
+        const instruction* const instr = &instrs[i];
+        if (instr->type != C_INSTR) {
+            continue;
+        }
+
+        const uint16_t in_a =
+            (i ? target_of(pg, &instrs[i - 1]) : SYM_TBL_NPOS);
+
+        if (in_a != SYM_TBL_NPOS && field_has(pg->src, instr->comp, 'A') &&
+            !field_is(pg->src, instr->comp, "A")) {
+            pin(pg, in_a);
+        }
+        if (in_d != SYM_TBL_NPOS && field_has(pg->src, instr->comp, 'D') &&
+            !field_is(pg->src, instr->comp, "D")) {
+            pin(pg, in_d);
+        }
+
+        if (field_has(pg->src, instr->dest, 'D')) {
+            if (in_a != SYM_TBL_NPOS && field_is(pg->src, instr->comp, "A")) {
+                in_d = in_a;
+            } else if (!field_is(pg->src, instr->comp, "D")) {
+                in_d = SYM_TBL_NPOS;
+            }
+        }
+    }
+}
+
+/* (re)builds the label lookups from the label definitions */
+static bool index_labels(program* const pg) {
+    sym_tbl_free(pg->targets);
+    pg->targets = sym_tbl_alloc_empty();
+    if (!pg->targets) {
+        return false;
+    }
+    memset(pg->labeled, 0, (pg->prog->len + 1) * sizeof(bool));
+
+    for (size_t i = 0; i < pg->labels->len; ++i) {
+        const label_def* const label = &pg->labels->labels[i];
+        const char* const name = pg->src + label->symbol.off;
+
+        /* the assembler ignores these, so we do too */
+        if (sym_tbl_lookup(pg->predefined, name, label->symbol.len) !=
+            SYM_TBL_NPOS) {
+            continue;
+        }
+
+        /* first definition wins, just like in the symbol table proper */
+        sym_tbl_insert(pg->targets, name, label->symbol.len,
+                       (uint16_t)label->idx);
+        pg->labeled[label->idx] = true;
+    }
+
+    pin_tables(pg);
+    return true;
+}
+
+/* a jump right after loading something other than a label goes to a fixed
+ * address, which would move if anything before it were removed */
+static bool jumps_to_labels_only(const program* const pg) {
+    const instruction* const instrs = pg->prog->instrs;
+
+    for (size_t i = 1; i < pg->prog->len; ++i) {
+        if (is_jump(&instrs[i]) && instrs[i - 1].type == A_INSTR &&
+            target_of(pg, &instrs[i - 1]) == SYM_TBL_NPOS) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* @L / jump, where L: @M / 0;JMP  =>  @M / jump */
+static bool retarget_chains(program* const pg) {
+    instruction* const instrs = pg->prog->instrs;
+    const size_t len = pg->prog->len;
+    bool changed = false;
+
+    for (size_t i = 0; i + 1 < len; ++i) {
+        instruction* const load = &instrs[i];
+        const instruction* const jump = &instrs[i + 1];
+        size_t t = target_of(pg, load);
+
+        if (t == SYM_TBL_NPOS || !is_jump(jump)) {
+            continue;
+        }
+
+        /* A ends up different, so nothing in the jump may depend on it */
+        if (field_has(pg->src, jump->comp, 'A') ||
+            field_has(pg->src, jump->comp, 'M') ||
+            (jump->dest.len && !field_is(pg->src, jump->dest, "D"))) {
+            continue;
+        }
+
+        /* ... and if the jump might not be taken, A gets reloaded anyway */
+        if (!is_goto(pg, jump) &&
+            (i + 2 >= len || instrs[i + 2].type != A_INSTR)) {
+            continue;
+        }
+
+        const size_t first = t;
+        src_span symbol = load->symbol;
+
+        /* follow the chain, giving up on cycles */
+        for (size_t steps = 0; t + 1 < len && steps < pg->labels->len;
+             ++steps) {
+            const instruction* const hop = &instrs[t];
+            const uint16_t next = target_of(pg, hop);
+
+            if (next == SYM_TBL_NPOS || next == t ||
+                !is_goto(pg, &instrs[t + 1]) || instrs[t + 1].dest.len) {
+                break;
+            }
+
+            symbol = hop->symbol;
+            t = next;
+        }
+
+        if (t != first) {
+            load->symbol = symbol;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/* 0;JMP / <anything but a label>  =>  0;JMP */
+static bool remove_unreachable(program* const pg) {
+    const instruction* const instrs = pg->prog->instrs;
+    const size_t len = pg->prog->len;
+    bool changed = false;
+
+    for (size_t i = 0; i < len; ++i) {
+        if (pg->dead[i] || !is_goto(pg, &instrs[i])) {
+            continue;
+        }
+
+        /* only a label can lead back in, or a jump table */
+        size_t k = i + 1;
+        for (; k < len && !pg->labeled[k] && !pg->pinned[k]; ++k) {
+            changed |= !pg->dead[k];
+            pg->dead[k] = true;
+        }
+
+        i = k - 1;
+    }
+
+    return changed;
+}
+
+/* @X / <doesn't touch A> / @X  =>  @X / <doesn't touch A> */
+static bool drop_reloads(program* const pg) {
+    const instruction* const instrs = pg->prog->instrs;
+    const instruction* loaded = NULL; /* what A holds, if we know */
+    bool changed = false;
+
+    for (size_t i = 0; i < pg->prog->len; ++i) {
+        /* control can come in from anywhere at a label, or a jump table */
+        if (pg->labeled[i] || pg->pinned[i]) {
+            loaded = NULL;
+        }
+
+        if (pg->dead[i]) {
+            continue;
+        }
+
+        if (instrs[i].type == A_INSTR) {
+            if (loaded && same_load(pg, loaded, &instrs[i])) {
+                pg->dead[i] = true;
+                changed = true;
+            } else {
+                loaded = &instrs[i];
+            }
+        } else if (writes_a(pg, &instrs[i])) {
+            loaded = NULL;
+        }
+    }
+
+    return changed;
+}
+
+/* squeezes out dead instructions, moving every label along */
+static void compact(program* const pg) {
+    instruction* const instrs = pg->prog->instrs;
+    const size_t len = pg->prog->len;
+    size_t kept = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        pg->remap[i] = (uint32_t)kept;
+
+        if (!pg->dead[i]) {
+            instrs[kept++] = instrs[i];
+        }
+    }
+    pg->remap[len] = (uint32_t)kept;
+
+    for (size_t i = 0; i < pg->labels->len; ++i) {
+        pg->labels->labels[i].idx = pg->remap[pg->labels->labels[i].idx];
+    }
+
+    pg->prog->len = kept;
+    memset(pg->dead, 0, len * sizeof(bool));
+}
+
+/* sets up the bookkeeping for a program; false when out of memory */
+static bool program_init(program* const pg, instr_array* const prog,
+                         label_array* const labels, const char* const src) {
+    *pg = (program){prog, labels, src, NULL, NULL, NULL, NULL, NULL, NULL};
+
+    pg->predefined = sym_tbl_alloc();
+    pg->labeled = calloc(prog->len + 1, sizeof(bool));
+    pg->pinned = calloc(prog->len + 1, sizeof(bool));
+    pg->dead = calloc(prog->len + 1, sizeof(bool));
+    pg->remap = malloc((prog->len + 1) * sizeof(uint32_t));
+
+    return pg->predefined && pg->labeled && pg->pinned && pg->dead &&
+           pg->remap && index_labels(pg);
+}
+
+static void program_free(program* const pg) {
+    free(pg->remap);
+    free(pg->dead);
+    free(pg->pinned);
+    free(pg->labeled);
+    sym_tbl_free(pg->targets);
+    sym_tbl_free(pg->predefined);
+}
+
+bool optimize_peephole(instr_array* const prog, label_array* const labels,
+                       const char* const src, const bool relocatable) {
+    /* instruction indices have to fit in the symbol table - a program that
+     * long is twice the size of the ROM, optimizing won't make it fit */
+    if (prog->len >= SYM_TBL_NPOS) {
+        return true;
+    }
+
+    bool ok = true;
+    program pg;
+
+    if (!program_init(&pg, prog, labels, src)) {
+        ok = false;
+        goto EXIT;
+    }
+
+    if (!jumps_to_labels_only(&pg)) {
+        goto EXIT;
+    }
+
+    for (unsigned round = 0; round < MAX_ROUNDS; ++round) {
+        /* an object linked earlier may define the same label, and win */
+        bool changed = (!relocatable && retarget_chains(&pg));
+        changed |= remove_unreachable(&pg);
+        changed |= drop_reloads(&pg);
+
+        if (!changed) {
+            break;
+        }
+
+        compact(&pg);
+
+        if (!index_labels(&pg)) {
+            ok = false;
+            goto EXIT;
+        }
+    }
+
+EXIT:
+    program_free(&pg);
+
+    return ok;
+}
+
+/* marks everything reachable from address 0: execution falls through to the
+ * next instruction (unless it always jumps), and any label whose address gets
+ * loaded might be jumped to - right away, or later through a return address
+ * stashed in D and memory. Jump tables could be entered anywhere, so all of
+ * their code counts as reachable */
+static bool mark_reachable(program* const pg, bool* const reached) {
+    const instruction* const instrs = pg->prog->instrs;
+    const size_t len = pg->prog->len;
+
+    /* every instruction gets visited once and pushes at most one target,
+     * plus there's address 0 and the jump tables to start from */
+    uint32_t* stack = malloc((2 * len + 1) * sizeof(uint32_t));
+    if (!stack) {
+        return false;
+    }
+
+    size_t nstack = 0;
+    for (size_t i = len; i-- > 0;) {
+        if (pg->pinned[i]) {
+            stack[nstack++] = (uint32_t)i;
+        }
+    }
+    if (len) {
+        stack[nstack++] = 0;
+    }
+
+    while (nstack) {
+        for (size_t i = stack[--nstack]; i < len && !reached[i]; ++i) {
+            reached[i] = true;
+
+            const uint16_t t = target_of(pg, &instrs[i]);
+            if (t != SYM_TBL_NPOS && t < len && !reached[t]) {
+                stack[nstack++] = t;
+            }
+
+            if (is_goto(pg, &instrs[i])) {
+                break;
+            }
+        }
+    }
+
+    free(stack);
+    return true;
+}
+
+/* drops label definitions no instruction refers to, along with those the
+ * assembler ignores anyway (duplicates and predefined names) */
+static bool drop_labels(program* const pg) {
+    const instruction* const instrs = pg->prog->instrs;
+    label_array* const labels = pg->labels;
+
+    sym_tbl* used = sym_tbl_alloc_empty();
+    sym_tbl* kept = sym_tbl_alloc_empty();
+    if (!used || !kept) {
+        sym_tbl_free(used);
+        sym_tbl_free(kept);
+        return false;
+    }
+
+    for (size_t i = 0; i < pg->prog->len; ++i) {
+        if (target_of(pg, &instrs[i]) != SYM_TBL_NPOS) {
+            sym_tbl_insert(used, pg->src + instrs[i].symbol.off,
+                           instrs[i].symbol.len, 0);
+        }
+    }
+
+    size_t nkept = 0;
+
+    for (size_t i = 0; i < labels->len; ++i) {
+        const label_def label = labels->labels[i];
+        const char* const name = pg->src + label.symbol.off;
+
+        if (sym_tbl_lookup(pg->predefined, name, label.symbol.len) ==
+                SYM_TBL_NPOS &&
+            sym_tbl_lookup(used, name, label.symbol.len) != SYM_TBL_NPOS &&
+            sym_tbl_insert(kept, name, label.symbol.len, 0)) {
+            labels->labels[nkept++] = label;
+        }
+    }
+
+    labels->len = nkept;
+
+    sym_tbl_free(used);
+    sym_tbl_free(kept);
+
+    return index_labels(pg);
+}
+
+bool optimize_dead_code(instr_array* const prog, label_array* const labels,
+                        const char* const src) {
+    /* instruction indices have to fit in the symbol table - a program that
+     * long is twice the size of the ROM, optimizing won't make it fit */
+    if (prog->len >= SYM_TBL_NPOS) {
+        return true;
+    }
+
+    bool ok = true;
+    program pg;
+    bool* reached = NULL;
+
+    if (!program_init(&pg, prog, labels, src)) {
+        ok = false;
+        goto EXIT;
+    }
+
+    if (!jumps_to_labels_only(&pg)) {
+        goto EXIT;
+    }
+
+    reached = calloc(prog->len + 1, sizeof(bool));
+    if (!reached || !mark_reachable(&pg, reached)) {
+        ok = false;
+        goto EXIT;
+    }
+
+    for (size_t i = 0; i < prog->len; ++i) {
+        pg.dead[i] = !reached[i];
+    }
+
+    compact(&pg);
+    ok = drop_labels(&pg);
+
+EXIT:
+    free(reached);
+    program_free(&pg);
+
+    return ok;
+}
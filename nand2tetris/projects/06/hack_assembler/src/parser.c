@@ -14,8 +14,8 @@
 
 #define _POSIX_C_SOURCE 200809L
 #include <stdio.h>  // for size_t, NULL, fprintf, stderr
-#include <stdlib.h> // for malloc, calloc, free, strtoul
-#include <string.h> // for strncpy
+#include <stdlib.h> // for malloc, calloc, realloc, free
+#include <string.h> // for strncmp
 
 #include "parser.h"
 
@@ -59,146 +59,369 @@ EXIT:
     return pmatch;
 }
 
-instruction* parse_instr(const char* const line, const uint16_t line_num) {
-    instruction* instr = malloc(sizeof(instruction));
-    instr->line_number = line_num;
-    instr->next = NULL;
+/* character classes used by the scanner */
+enum {
+    CC_OTHER = 0,
+    CC_SPACE = 1 << 0,  /* horizontal whitespace */
+    CC_EOL = 1 << 1,    /* endline characters */
+    CC_DIGIT = 1 << 2,  /* decimal digits */
+    CC_SYMBOL = 1 << 3, /* may start a symbol */
+};
 
-    regmatch_t* pmatch = NULL;
-    size_t nsub = 0;
-    size_t off = 0, len = 0;
+static const unsigned char CHAR_CLASS[256] = {
+    ['\t'] = CC_SPACE, [' '] = CC_SPACE, ['\n'] = CC_EOL, ['\r'] = CC_EOL,
+    ['0'] = CC_DIGIT,  ['1'] = CC_DIGIT, ['2'] = CC_DIGIT, ['3'] = CC_DIGIT,
+    ['4'] = CC_DIGIT,  ['5'] = CC_DIGIT, ['6'] = CC_DIGIT, ['7'] = CC_DIGIT,
+    ['8'] = CC_DIGIT,  ['9'] = CC_DIGIT, ['_'] = CC_SYMBOL, ['.'] = CC_SYMBOL,
+    ['$'] = CC_SYMBOL, [':'] = CC_SYMBOL, ['A'] = CC_SYMBOL, ['B'] = CC_SYMBOL,
+    ['C'] = CC_SYMBOL, ['D'] = CC_SYMBOL, ['E'] = CC_SYMBOL, ['F'] = CC_SYMBOL,
+    ['G'] = CC_SYMBOL, ['H'] = CC_SYMBOL, ['I'] = CC_SYMBOL, ['J'] = CC_SYMBOL,
+    ['K'] = CC_SYMBOL, ['L'] = CC_SYMBOL, ['M'] = CC_SYMBOL, ['N'] = CC_SYMBOL,
+    ['O'] = CC_SYMBOL, ['P'] = CC_SYMBOL, ['Q'] = CC_SYMBOL, ['R'] = CC_SYMBOL,
+    ['S'] = CC_SYMBOL, ['T'] = CC_SYMBOL, ['U'] = CC_SYMBOL, ['V'] = CC_SYMBOL,
+    ['W'] = CC_SYMBOL, ['X'] = CC_SYMBOL, ['Y'] = CC_SYMBOL, ['Z'] = CC_SYMBOL,
+    ['a'] = CC_SYMBOL, ['b'] = CC_SYMBOL, ['c'] = CC_SYMBOL, ['d'] = CC_SYMBOL,
+    ['e'] = CC_SYMBOL, ['f'] = CC_SYMBOL, ['g'] = CC_SYMBOL, ['h'] = CC_SYMBOL,
+    ['i'] = CC_SYMBOL, ['j'] = CC_SYMBOL, ['k'] = CC_SYMBOL, ['l'] = CC_SYMBOL,
+    ['m'] = CC_SYMBOL, ['n'] = CC_SYMBOL, ['o'] = CC_SYMBOL, ['p'] = CC_SYMBOL,
+    ['q'] = CC_SYMBOL, ['r'] = CC_SYMBOL, ['s'] = CC_SYMBOL, ['t'] = CC_SYMBOL,
+    ['u'] = CC_SYMBOL, ['v'] = CC_SYMBOL, ['w'] = CC_SYMBOL, ['x'] = CC_SYMBOL,
+    ['y'] = CC_SYMBOL, ['z'] = CC_SYMBOL,
+};
+
+#define IS_CLASS(c, cc) (CHAR_CLASS[(unsigned char)(c)] & (cc))
+
+/* dest: null, A, D, M, AD, AM, DM, ADM */
+static bool valid_dest(const char* const s, const size_t n) {
+    switch (n) {
+    case 1:
+        return s[0] == 'A' || s[0] == 'D' || s[0] == 'M';
+    case 2:
+        return (s[0] == 'A' && (s[1] == 'D' || s[1] == 'M')) ||
+               (s[0] == 'D' && s[1] == 'M');
+    case 3:
+        return s[0] == 'A' && s[1] == 'D' && s[2] == 'M';
+    case 4:
+        return !strncmp(s, "null", 4);
+    }
+
+    return false;
+}
+
+/* comp: 0, -?1, [-!]?[ADM], [ADM][+-]1, D[-+&|][AM], [AM]-D */
+static bool valid_comp(const char* const s, const size_t n) {
+    switch (n) {
+    case 1:
+        return s[0] == '0' || s[0] == '1' || s[0] == 'A' || s[0] == 'D' ||
+               s[0] == 'M';
+    case 2:
+        return (s[0] == '-' && (s[1] == '1' || s[1] == 'A' || s[1] == 'D' ||
+                                s[1] == 'M')) ||
+               (s[0] == '!' && (s[1] == 'A' || s[1] == 'D' || s[1] == 'M'));
+    case 3:
+        if ((s[0] == 'A' || s[0] == 'D' || s[0] == 'M') &&
+            (s[1] == '+' || s[1] == '-') && s[2] == '1') {
+            return true;
+        }
+        if (s[0] == 'D' &&
+            (s[1] == '+' || s[1] == '-' || s[1] == '&' || s[1] == '|') &&
+            (s[2] == 'A' || s[2] == 'M')) {
+            return true;
+        }
+        return (s[0] == 'A' || s[0] == 'M') && s[1] == '-' && s[2] == 'D';
+    }
+
+    return false;
+}
+
+/* jump: null, JGT, JGE, JLT, JLE, JEQ, JNE, JMP */
+static bool valid_jump(const char* const s, const size_t n) {
+    if (n == 4) {
+        return !strncmp(s, "null", 4);
+    }
+
+    if (n != 3 || s[0] != 'J') {
+        return false;
+    }
+
+    switch (s[1]) {
+    case 'G':
+    case 'L':
+        return s[2] == 'T' || s[2] == 'E';
+    case 'E':
+        return s[2] == 'Q';
+    case 'N':
+        return s[2] == 'E';
+    case 'M':
+        return s[2] == 'P';
+    }
+
+    return false;
+}
+
+/* is the rest of the line (from i) only whitespace, a comment and an endline? */
+static bool at_line_end(const char* const line, size_t i, const size_t len) {
+    while (i < len && IS_CLASS(line[i], CC_SPACE)) {
+        ++i;
+    }
+
+    if (i + 1 < len && line[i] == '/' && line[i + 1] == '/') {
+        return true;
+    }
+
+    /* accepts \n, \r\n, \r, or no endline at all on the last line */
+    if (i < len && line[i] == '\r') {
+        ++i;
+    }
+    if (i < len && line[i] == '\n') {
+        ++i;
+    }
+
+    return i == len;
+}
+
+/* extent of a symbol starting at i, 0 if there isn't one */
+static size_t scan_symbol(const char* const line, const size_t i,
+                          const size_t len) {
+    if (i >= len || !IS_CLASS(line[i], CC_SYMBOL)) {
+        return 0;
+    }
+
+    size_t j = i + 1;
+    while (j < len && IS_CLASS(line[j], CC_SYMBOL | CC_DIGIT)) {
+        ++j;
+    }
+
+    return j - i;
+}
+
+bool scan_instr(const char* const line, const size_t len,
+                scanned_instr* const out) {
+    if (!line || !out) {
+        return false;
+    }
 
     /* note that the spec only declares that leading space characters are
      * ignored - I am choosing to also ignore leading and trailing space and tab
      * characters */
 
-    if ((pmatch =
-             match_regex(line, "^[ \t]*@([0-9]+)[ \t]*(\n|\r\n|\r)$", &nsub))) {
-        /* value @ pmatch[1] */
-        if (nsub < 1) {
-            goto NOMATCH_EXIT;
+    size_t i = 0;
+    while (i < len && IS_CLASS(line[i], CC_SPACE)) {
+        ++i;
+    }
+
+    *out = (scanned_instr){.type = COMMENT_IGNORE};
+
+    /* comments and "empty" lines */
+    if (i == len || IS_CLASS(line[i], CC_EOL) || line[i] == '/') {
+        return at_line_end(line, i, len);
+    }
+
+    switch (line[i]) {
+    case '@':
+        ++i;
+
+        if (i < len && IS_CLASS(line[i], CC_DIGIT)) {
+            /* A-instruction with constant address value */
+            uint16_t addr = 0;
+            while (i < len && IS_CLASS(line[i], CC_DIGIT)) {
+                addr = (uint16_t)(addr * 10 + (uint16_t)(line[i++] - '0'));
+            }
+
+            out->type = A_INSTR;
+            out->resolved = true;
+            out->addr = addr;
+        } else {
+            /* A-instruction with symbol */
+            const size_t sym_len = scan_symbol(line, i, len);
+            if (!sym_len) {
+                return false;
+            }
+
+            out->type = A_INSTR;
+            out->resolved = false;
+            out->symbol = (str_view){line + i, sym_len};
+            i += sym_len;
         }
 
-        /* extract value */
-        off = (size_t)pmatch[1].rm_so;
-        len = (size_t)(pmatch[1].rm_eo - pmatch[1].rm_so);
-        char* str = calloc(len + 1, sizeof(char));
-        strncpy(str, line + off, len);
-
-        instr->addr = (uint16_t)strtoul(str, NULL, 10);
-        free(str);
-
-        /* A-instruction with constant address value */
-        instr->type = A_INSTR;
-        instr->resolved = true;
-    } else if ((pmatch = match_regex(
-                    line,
-                    "^[ \t]*@([a-zA-Z_\\.\\$:][a-zA-Z0-9_\\.\\$:]*)[ "
-                    "\t]*(\n|\r\n|\r)$",
-                    &nsub))) {
-        /* addr @ pmatch[1] */
-        if (nsub < 1) {
-            goto NOMATCH_EXIT;
+        return at_line_end(line, i, len);
+    case '(': {
+        /* L-instructions */
+        const size_t sym_len = scan_symbol(line, ++i, len);
+        if (!sym_len || i + sym_len >= len || line[i + sym_len] != ')') {
+            return false;
         }
 
-        /* extract symbol */
-        off = (size_t)pmatch[1].rm_so;
-        len = (size_t)(pmatch[1].rm_eo - pmatch[1].rm_so);
-        instr->symbol = calloc(len + 1, sizeof(char));
-        strncpy(instr->symbol, line + off, len);
-
-        /* A-instruction with symbol */
-        instr->type = A_INSTR;
-        instr->resolved = false;
-    } else if ((pmatch = match_regex(
-                    line,
-                    "^[ "
-                    "\t]*((null|ADM|AD?M?|DM?|M)=)?(0|-?1|[-!]?[ADM]|[ADM]["
-                    "\\+-]1|D[-\\+&\\|][AM]|[AM]-D)(;(null|J([GL][TE]|EQ|NE|MP)"
-                    "))?[ \t]*(\n|\r\n|\r)$",
-                    &nsub))) {
-        /* dest @ pmatch[2]
-         * comp @ pmatch[3]
-         * jump @ pmatch[5] */
-        if (nsub < 5) {
-            goto NOMATCH_EXIT;
+        out->type = L_INSTR;
+        out->resolved = false;
+        out->symbol = (str_view){line + i, sym_len};
+
+        return at_line_end(line, i + sym_len + 1, len);
+    }
+    }
+
+    /* C-instruction: [dest=]comp[;jump] - find the extent of each field */
+    const size_t start = i;
+    size_t eq = len, semi = len;
+
+    while (i < len && !IS_CLASS(line[i], CC_SPACE | CC_EOL) &&
+           !(line[i] == '/' && i + 1 < len && line[i + 1] == '/')) {
+        if (line[i] == '=' && eq == len && semi == len) {
+            eq = i;
+        } else if (line[i] == ';' && semi == len) {
+            semi = i;
         }
+        ++i;
+    }
+
+    const size_t comp_start = (eq == len ? start : eq + 1);
+    const size_t comp_end = (semi == len ? i : semi);
+
+    if (comp_end < comp_start) {
+        return false;
+    }
+
+    out->type = C_INSTR;
+    if (eq != len) {
+        out->dest = (str_view){line + start, eq - start};
+    }
+    out->comp = (str_view){line + comp_start, comp_end - comp_start};
+    if (semi != len) {
+        out->jump = (str_view){line + semi + 1, i - semi - 1};
+    }
+
+    if ((eq != len && !valid_dest(out->dest.ptr, out->dest.len)) ||
+        !valid_comp(out->comp.ptr, out->comp.len) ||
+        (semi != len && !valid_jump(out->jump.ptr, out->jump.len))) {
+        return false;
+    }
 
-        /* extract fields */
-        off = (size_t)pmatch[2].rm_so;
-        len = (size_t)(pmatch[2].rm_eo - pmatch[2].rm_so);
-        instr->dest = calloc(len + 1, sizeof(char));
-        strncpy(instr->dest, line + off, len);
-
-        off = (size_t)pmatch[3].rm_so;
-        len = (size_t)(pmatch[3].rm_eo - pmatch[3].rm_so);
-        instr->comp = calloc(len + 1, sizeof(char));
-        strncpy(instr->comp, line + off, len);
-
-        off = (size_t)pmatch[5].rm_so;
-        len = (size_t)(pmatch[5].rm_eo - pmatch[5].rm_so);
-        instr->jump = calloc(len + 1, sizeof(char));
-        strncpy(instr->jump, line + off, len);
-
-        /* C-istruction */
-        instr->type = C_INSTR;
-    } else if ((pmatch = match_regex(
-                    line,
-                    "^[ "
-                    "\t]*\\(([a-zA-Z_\\.\\$:][a-zA-Z0-9_\\.\\$:]*)\\)[ "
-                    "\t]*(\n|\r\n|\r)$",
-                    &nsub))) {
-        /* sym @ pmatch[1] */
-        if (nsub < 1) {
-            goto NOMATCH_EXIT;
+    return at_line_end(line, i, len);
+}
+
+/* view of a scanned field as a span relative to the start of the source */
+static src_span to_span(const char* const src, const str_view view) {
+    return (src_span){(uint32_t)(view.ptr - src), (uint32_t)view.len};
+}
+
+bool parse_instr(const char* const src, const size_t off, const size_t len,
+                 const uint32_t line_num, instruction* const instr) {
+    scanned_instr fields;
+
+    if (!src || !instr || !scan_instr(src + off, len, &fields)) {
+        return false;
+    }
+
+    instr->type = fields.type;
+    instr->line_number = line_num;
+
+    switch (fields.type) {
+    case A_INSTR:
+    case L_INSTR:
+        instr->resolved = fields.resolved;
+        if (fields.resolved) {
+            instr->addr = fields.addr;
+        } else {
+            instr->symbol = to_span(src, fields.symbol);
         }
+        break;
+    case C_INSTR:
+        instr->dest = to_span(src, fields.dest);
+        instr->comp = to_span(src, fields.comp);
+        instr->jump = to_span(src, fields.jump);
+        break;
+    case COMMENT_IGNORE:
+        break;
+    }
 
-        /* extract symbol */
-        off = (size_t)pmatch[1].rm_so;
-        len = (size_t)(pmatch[1].rm_eo - pmatch[1].rm_so);
-        instr->symbol = calloc(len + 1, sizeof(char));
-        strncpy(instr->symbol, line + off, len);
+    return true;
+}
 
-        /* L-instructions */
-        instr->type = L_INSTR;
-        instr->resolved = false;
-    } else if ((pmatch = match_regex(
-                    line, "^[ \t]*((//.*)|([ \t]*))(\n|\r\n|\r)$", &nsub))) {
-        /* comments and "empty" lines */
-        instr->type = COMMENT_IGNORE;
-    } else {
-        free(instr);
-        instr = NULL;
+bool instr_array_init(instr_array* const arr, const size_t cap_hint) {
+    *arr = (instr_array){NULL, 0, 0, 0};
+
+    const size_t cap = (cap_hint ? cap_hint : 64);
+    arr->instrs = malloc(cap * sizeof(instruction));
+    if (!arr->instrs) {
+        return false;
     }
 
-    free(pmatch);
-    return instr;
+    arr->cap = cap;
+    arr->nallocs = 1;
+    return true;
+}
 
-NOMATCH_EXIT:
-    fprintf(stderr,
-            "[ERROR] Regex parsing failed on input line %u with incorrect "
-            "number of captured subexpressions (%zu)\n",
-            line_num, nsub);
-    free(pmatch);
-    free(instr);
-    return NULL;
+instruction* instr_array_push(instr_array* const arr) {
+    if (arr->len == arr->cap) {
+        instruction* grown =
+            realloc(arr->instrs, 2 * arr->cap * sizeof(instruction));
+        if (!grown) {
+            return NULL;
+        }
+
+        arr->instrs = grown;
+        arr->cap *= 2;
+        ++arr->nallocs;
+    }
+
+    return &arr->instrs[arr->len++];
+}
+
+void instr_array_free(instr_array* const arr) {
+    free(arr->instrs);
+    *arr = (instr_array){NULL, 0, 0, 0};
 }
 
-bool resolve_reference(instruction* const instr, sym_tbl* const tbl,
-                       uint16_t* const nvars) {
+bool label_array_init(label_array* const arr, const size_t cap_hint) {
+    *arr = (label_array){NULL, 0, 0, 0};
+
+    const size_t cap = (cap_hint ? cap_hint : 64);
+    arr->labels = malloc(cap * sizeof(label_def));
+    if (!arr->labels) {
+        return false;
+    }
+
+    arr->cap = cap;
+    arr->nallocs = 1;
+    return true;
+}
+
+label_def* label_array_push(label_array* const arr) {
+    if (arr->len == arr->cap) {
+        label_def* grown =
+            realloc(arr->labels, 2 * arr->cap * sizeof(label_def));
+        if (!grown) {
+            return NULL;
+        }
+
+        arr->labels = grown;
+        arr->cap *= 2;
+        ++arr->nallocs;
+    }
+
+    return &arr->labels[arr->len++];
+}
+
+void label_array_free(label_array* const arr) {
+    free(arr->labels);
+    *arr = (label_array){NULL, 0, 0, 0};
+}
+
+bool resolve_reference(instruction* const instr, const char* const src,
+                       sym_tbl* const tbl, uint16_t* const nvars) {
     /* series of checks short-circuits before accessing undefined memory */
-    if (!instr || !tbl || instr->type != A_INSTR || instr->resolved) {
+    if (!instr || !src || !tbl || instr->type != A_INSTR || instr->resolved) {
         return false;
     }
 
+    const char* const sym = src + instr->symbol.off;
+    const size_t sym_len = instr->symbol.len;
+
     /* note we're deciding to use a different alternative in the union */
-    if (sym_tbl_insert(tbl, instr->symbol, *nvars)) {
-        free(instr->symbol);
+    if (sym_tbl_insert(tbl, sym, sym_len, *nvars)) {
         instr->addr = (*nvars)++;
     } else {
-        uint16_t addr = sym_tbl_lookup(tbl, instr->symbol);
-        free(instr->symbol);
-        instr->addr = addr;
+        instr->addr = sym_tbl_lookup(tbl, sym, sym_len);
     }
 
     return (instr->resolved = true);
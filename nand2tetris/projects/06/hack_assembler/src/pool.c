@@ -0,0 +1,173 @@
+/**
+ * @file pool.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module provides a fixed-size pool of worker
+ * threads, used to run independent pieces of work (chunks of a source file,
+ * whole source files) in parallel.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h> // for pthread_*
+#include <stdbool.h> // for bool, true, false
+#include <stdlib.h>  // for malloc, calloc, free
+#include <unistd.h>  // for sysconf
+
+#include "pool.h"
+
+struct thread_pool {
+    pthread_t* workers;
+    size_t nworkers; /* threads besides the caller of pool_for */
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready; /* a new batch was posted, or shutting down */
+    pthread_cond_t work_done;  /* the last task of a batch finished */
+
+    /* the current batch, all protected by lock */
+    pool_task task;
+    void* ctx;
+    size_t ntasks;
+    size_t next;  /* next task index to hand out */
+    size_t ndone; /* number of tasks finished */
+    unsigned long batch; /* bumped for every new batch */
+    bool shutdown;
+};
+
+/* hands out and runs tasks from the current batch until there are none left;
+ * called and returns with the lock held */
+static void run_tasks(thread_pool* const pool) {
+    while (pool->next < pool->ntasks) {
+        const size_t idx = pool->next++;
+        pool_task task = pool->task;
+        void* ctx = pool->ctx;
+
+        pthread_mutex_unlock(&pool->lock);
+        task(ctx, idx);
+        pthread_mutex_lock(&pool->lock);
+
+        if (++pool->ndone == pool->ntasks) {
+            pthread_cond_broadcast(&pool->work_done);
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    thread_pool* const pool = arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;) {
+        while (!pool->shutdown && pool->batch == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+
+        if (pool->shutdown) {
+            break;
+        }
+
+        seen = pool->batch;
+        run_tasks(pool);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+thread_pool* pool_alloc(const size_t nthreads) {
+    thread_pool* pool = calloc(1, sizeof(thread_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    if (nthreads > 1) {
+        pool->workers = malloc((nthreads - 1) * sizeof(pthread_t));
+        if (!pool->workers) {
+            pool_free(pool);
+            return NULL;
+        }
+    }
+
+    /* run with however many workers we actually managed to start */
+    for (size_t i = 0; i + 1 < nthreads; ++i) {
+        if (pthread_create(&pool->workers[i], NULL, worker_main, pool)) {
+            break;
+        }
+        ++pool->nworkers;
+    }
+
+    return pool;
+}
+
+void pool_free(thread_pool* const pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->nworkers; ++i) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+
+    free(pool->workers);
+    free(pool);
+}
+
+void pool_for(thread_pool* const pool, const size_t ntasks, pool_task task,
+              void* const ctx) {
+    if (!task || !ntasks) {
+        return;
+    }
+
+    /* no pool, no threads - just run everything here */
+    if (!pool) {
+        for (size_t idx = 0; idx < ntasks; ++idx) {
+            task(ctx, idx);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->ntasks = ntasks;
+    pool->next = 0;
+    pool->ndone = 0;
+    ++pool->batch;
+    pthread_cond_broadcast(&pool->work_ready);
+
+    /* the caller works too, then waits for stragglers */
+    run_tasks(pool);
+    while (pool->ndone < pool->ntasks) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+size_t pool_size(const thread_pool* const pool) {
+    return (pool ? pool->nworkers + 1 : 1);
+}
+
+size_t pool_ncpus(void) {
+    const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (ncpus > 0 ? (size_t)ncpus : 1);
+}
@@ -0,0 +1,185 @@
+/**
+ * @file scan.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module splits a source into lines a block
+ * at a time: every 64 bytes are turned into a bitmask of endline characters
+ * with vector compares, so finding the next line is a bit scan rather than a
+ * call to memchr per line. The widest instruction set the processor supports
+ * (AVX2, then SSE2, then plain C) is picked the first time it's needed.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h> // for pthread_once, pthread_once_t, PTHREAD_ONCE_INIT
+#include <stdbool.h> // for bool, true, false
+#include <stdint.h>  // for uint64_t, uint32_t
+#include <string.h>  // for strcmp
+
+#include "scan.h"
+
+/* vector code needs GCC/Clang extensions for picking it at run time */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h> // for __m128i, __m256i, _mm_cmpeq_epi8, ...
+#endif
+
+/* the endlines in a whole block, bit i set if byte i is '\n' */
+typedef uint64_t (*block_fn)(const char* const block);
+
+static uint64_t block_scalar(const char* const block) {
+    uint64_t mask = 0;
+
+    for (unsigned i = 0; i < SCAN_BLOCK_LEN; ++i) {
+        mask |= (uint64_t)(block[i] == '\n') << i;
+    }
+
+    return mask;
+}
+
+#ifdef SCAN_X86
+__attribute__((target("sse2"))) static uint64_t
+block_sse2(const char* const block) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+
+    for (unsigned i = 0; i < SCAN_BLOCK_LEN; i += 16) {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*)(block + i));
+        const uint32_t bits =
+            (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nl));
+        mask |= (uint64_t)bits << i;
+    }
+
+    return mask;
+}
+
+__attribute__((target("avx2"))) static uint64_t
+block_avx2(const char* const block) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+
+    const __m256i lo = _mm256_loadu_si256((const __m256i*)block);
+    const __m256i hi = _mm256_loadu_si256((const __m256i*)(block + 32));
+    const uint32_t lo_bits =
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl));
+    const uint32_t hi_bits =
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl));
+
+    return (uint64_t)hi_bits << 32 | lo_bits;
+}
+#endif
+
+/* every instruction set, widest first */
+static const struct {
+    const char* name;
+    block_fn fn;
+} IMPLS[] = {
+#ifdef SCAN_X86
+    {"avx2", block_avx2},
+    {"sse2", block_sse2},
+#endif
+    {"scalar", block_scalar},
+};
+
+#define NIMPLS (sizeof(IMPLS) / sizeof(IMPLS[0]))
+
+/* the instruction set in use, an index into IMPLS */
+static size_t IMPL;
+static pthread_once_t IMPL_ONCE = PTHREAD_ONCE_INIT;
+
+static bool supported(const size_t impl) {
+#ifdef SCAN_X86
+    if (!strcmp(IMPLS[impl].name, "avx2")) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (!strcmp(IMPLS[impl].name, "sse2")) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    (void)impl;
+    return true;
+}
+
+static void impl_init(void) {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+#endif
+
+    /* the scalar version is always supported, so this always finds one */
+    for (IMPL = 0; !supported(IMPL); ++IMPL) {
+    }
+}
+
+bool scan_use(const char* const name) {
+    pthread_once(&IMPL_ONCE, impl_init);
+
+    for (size_t i = 0; i < NIMPLS; ++i) {
+        if (!strcmp(IMPLS[i].name, name) && supported(i)) {
+            IMPL = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char* scan_impl(void) {
+    pthread_once(&IMPL_ONCE, impl_init);
+    return IMPLS[IMPL].name;
+}
+
+/* the endlines in the block at sc->block, which may be cut short by the end
+ * of the range */
+static uint64_t block_mask(const line_scanner* const sc) {
+    const char* const block = sc->data + sc->block;
+
+    if (sc->end - sc->block >= SCAN_BLOCK_LEN) {
+        return IMPLS[IMPL].fn(block);
+    }
+
+    uint64_t mask = 0;
+    for (size_t i = 0; i < sc->end - sc->block; ++i) {
+        mask |= (uint64_t)(block[i] == '\n') << i;
+    }
+
+    return mask;
+}
+
+void scan_init(line_scanner* const sc, const char* const data,
+               const size_t begin, const size_t end) {
+    pthread_once(&IMPL_ONCE, impl_init);
+
+    *sc = (line_scanner){data, end, begin, 0};
+    if (begin < end) {
+        sc->mask = block_mask(sc);
+    }
+}
+
+size_t scan_next(line_scanner* const sc) {
+    while (!sc->mask) {
+        sc->block += SCAN_BLOCK_LEN;
+        if (sc->block >= sc->end) {
+            sc->block = sc->end;
+            return sc->end;
+        }
+
+        sc->mask = block_mask(sc);
+    }
+
+#ifdef __GNUC__
+    const size_t bit = (size_t)__builtin_ctzll(sc->mask);
+#else
+    size_t bit = 0;
+    while (!(sc->mask >> bit & 1)) {
+        ++bit;
+    }
+#endif
+
+    const size_t off = sc->block + bit + 1;
+    sc->mask &= sc->mask - 1; /* clear the lowest set bit */
+
+    return off;
+}
@@ -13,63 +13,148 @@
  */
 
 #define _POSIX_C_SOURCE 200809L
-#include <stdint.h> // for UINT16_MAX
-#include <stdlib.h> // for calloc, size_t
-#include <string.h> // for strdup, strlen
+#include <pthread.h> // for pthread_once, pthread_once_t, PTHREAD_ONCE_INIT
+#include <stdint.h> // for UINT16_MAX, uint32_t
+#include <stdlib.h> // for calloc, malloc, realloc, free, size_t
+#include <string.h> // for memcmp, memcpy, strlen
 
 #include "sym_tbl.h"
 
 const uint16_t SYM_TBL_NPOS = UINT16_MAX;
 
-/* the maximum number of symbols we might need to map */
-static const uint16_t TBL_CAP = (1 << 14) + 7;
+/* starting number of slots, must be a power of 2 */
+static const uint32_t TBL_INIT_CAP = 1 << 8;
 
-typedef struct bucket {
-    char* symbol;
+/* the table grows once more than 3/4 of its slots are in use */
+#define TBL_MAX_LOAD(cap) ((cap) / 4 * 3)
+
+/* starting size of the string arena, in bytes */
+static const size_t STRS_INIT_CAP = 1 << 12;
+
+/* an entry in the table, empty when key_len is 0 (symbols are never empty) */
+typedef struct slot {
+    uint32_t hash;    /* full hash of the key, to skip most string compares */
+    uint32_t key_off; /* offset of the key in the string arena */
+    uint32_t key_len;
+    uint16_t address;
+} slot;
+
+/* symbols every program starts out with */
+static const struct {
+    const char* symbol;
     uint16_t address;
-    struct bucket* next;
-} bucket;
+} PREDEFINED[] = {
+    {"R0", 0},   {"R1", 1},   {"R2", 2},   {"R3", 3},
+    {"R4", 4},   {"R5", 5},   {"R6", 6},   {"R7", 7},
+    {"R8", 8},   {"R9", 9},   {"R10", 10}, {"R11", 11},
+    {"R12", 12}, {"R13", 13}, {"R14", 14}, {"R15", 15},
+
+    {"SP", 0},   {"LCL", 1},  {"ARG", 2},  {"THIS", 3}, {"THAT", 4},
+
+    {"SCREEN", 16384}, {"KBD", 24576},
+};
 
 struct sym_tbl {
-    bucket** buckets;
+    slot* slots;
+    uint32_t cap; /* number of slots, always a power of 2 */
+    uint32_t len; /* number of slots in use */
+
+    /* interned keys, stored back to back (not NUL-terminated) */
+    char* strs;
+    size_t strs_len;
+    size_t strs_cap;
+
+    size_t nallocs; /* heap blocks allocated or resized, for sym_tbl_stats */
+
     bool initialized;
-    uint16_t nvars;
 };
 
+/* the predefined symbols, hashed and interned once per process, then only
+ * ever read - every new table starts out as a copy of this one */
+static sym_tbl BASE_TBL;
+static pthread_once_t BASE_TBL_ONCE = PTHREAD_ONCE_INIT;
+
+/* whether BASE_TBL was built - once it wasn't, no table can be copied from
+ * it, so every later sym_tbl_alloc fails as well */
+static bool BASE_TBL_OK = false;
+
+static void base_tbl_init(void) {
+    sym_tbl* const empty = sym_tbl_alloc_empty();
+    if (!empty) {
+        return;
+    }
+    BASE_TBL = *empty;
+    free(empty);
+
+    /* add predefied symbols to the table */
+    for (size_t i = 0; i < sizeof(PREDEFINED) / sizeof(PREDEFINED[0]); ++i) {
+        if (!sym_tbl_insert(&BASE_TBL, PREDEFINED[i].symbol,
+                            strlen(PREDEFINED[i].symbol),
+                            PREDEFINED[i].address)) {
+            free(BASE_TBL.slots);
+            free(BASE_TBL.strs);
+            BASE_TBL = (sym_tbl){0};
+            return;
+        }
+    }
+
+    BASE_TBL_OK = true;
+}
+
 sym_tbl* sym_tbl_alloc() {
+    pthread_once(&BASE_TBL_ONCE, base_tbl_init);
+    if (!BASE_TBL_OK) {
+        return NULL;
+    }
+
     sym_tbl* tbl = (sym_tbl*)malloc(sizeof(sym_tbl));
+    if (!tbl) {
+        return NULL;
+    }
+    *tbl = BASE_TBL;
+
+    /* copy rather than share, so the new table is free to grow */
+    tbl->slots = (slot*)malloc(BASE_TBL.cap * sizeof(slot));
+    tbl->strs = malloc(BASE_TBL.strs_cap);
+    if (!tbl->slots || !tbl->strs) {
+        free(tbl->slots);
+        free(tbl->strs);
+        free(tbl);
+        return NULL;
+    }
 
-    /* note that calloc zeros out the memory */
-    tbl->buckets = (bucket**)calloc(TBL_CAP, sizeof(bucket*));
-    tbl->initialized = true;
-    tbl->nvars = 0;
+    memcpy(tbl->slots, BASE_TBL.slots, BASE_TBL.cap * sizeof(slot));
+    memcpy(tbl->strs, BASE_TBL.strs, BASE_TBL.strs_len);
 
-    /* add predefied symbols to the table */
-    sym_tbl_insert(tbl, "R0", 0);
-    sym_tbl_insert(tbl, "R1", 1);
-    sym_tbl_insert(tbl, "R2", 2);
-    sym_tbl_insert(tbl, "R3", 3);
-    sym_tbl_insert(tbl, "R4", 4);
-    sym_tbl_insert(tbl, "R5", 5);
-    sym_tbl_insert(tbl, "R6", 6);
-    sym_tbl_insert(tbl, "R7", 7);
-    sym_tbl_insert(tbl, "R8", 8);
-    sym_tbl_insert(tbl, "R9", 9);
-    sym_tbl_insert(tbl, "R10", 10);
-    sym_tbl_insert(tbl, "R11", 11);
-    sym_tbl_insert(tbl, "R12", 12);
-    sym_tbl_insert(tbl, "R13", 13);
-    sym_tbl_insert(tbl, "R14", 14);
-    sym_tbl_insert(tbl, "R15", 15);
-
-    sym_tbl_insert(tbl, "SP", 0);
-    sym_tbl_insert(tbl, "LCL", 1);
-    sym_tbl_insert(tbl, "ARG", 2);
-    sym_tbl_insert(tbl, "THIS", 3);
-    sym_tbl_insert(tbl, "THAT", 4);
-
-    sym_tbl_insert(tbl, "SCREEN", 16384);
-    sym_tbl_insert(tbl, "KBD", 24576);
+    tbl->nallocs = 3;
+
+    return tbl;
+}
+
+sym_tbl* sym_tbl_alloc_empty() {
+    sym_tbl* tbl = (sym_tbl*)malloc(sizeof(sym_tbl));
+    if (!tbl) {
+        return NULL;
+    }
+
+    /* note that calloc zeros out the memory, marking every slot empty */
+    tbl->slots = (slot*)calloc(TBL_INIT_CAP, sizeof(slot));
+    tbl->strs = malloc(STRS_INIT_CAP);
+    if (!tbl->slots || !tbl->strs) {
+        free(tbl->slots);
+        free(tbl->strs);
+        free(tbl);
+        return NULL;
+    }
+
+    tbl->cap = TBL_INIT_CAP;
+    tbl->len = 0;
+
+    tbl->strs_len = 0;
+    tbl->strs_cap = STRS_INIT_CAP;
+
+    tbl->nallocs = 3;
+    tbl->initialized = true;
 
     return tbl;
 }
@@ -79,87 +164,174 @@ void sym_tbl_free(sym_tbl* tbl) {
         return;
     }
 
-    for (size_t i = 0; i < TBL_CAP; ++i) {
-        /* need to free all nodes in conflict chain */
-        for (bucket* next_bckt = tbl->buckets[i]; next_bckt;) {
-            free(next_bckt->symbol);
+    /* everything lives in two blocks, no need to walk the table */
+    free(tbl->slots);
+    free(tbl->strs);
+    free(tbl);
+    tbl = NULL;
+}
 
-            bucket* last_bckt = next_bckt;
-            next_bckt = next_bckt->next;
-            free(last_bckt);
-        }
+static uint32_t hash(const char* const sym, const size_t len) {
+    /* 32-bit FNV-1a [http://www.isthe.com/chongo/tech/comp/fnv/] */
+
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= (unsigned char)sym[i];
+        hash *= 16777619u;
     }
 
-    free(tbl->buckets);
-    free(tbl);
-    tbl = NULL;
+    return hash;
 }
 
-/* why doesn't this exist in <math.h>????? */
-static uint16_t powu16(const uint16_t base, const uint16_t exp) {
-    uint16_t result = 1;
+/* index of the slot holding sym, or of the empty slot where it would go */
+static uint32_t probe(const sym_tbl* const tbl, const char* const sym,
+                      const size_t len, const uint32_t h) {
+    const uint32_t mask = tbl->cap - 1;
+
+    /* linear probing - the table is never full, so this always terminates */
+    for (uint32_t idx = h & mask;; idx = (idx + 1) & mask) {
+        const slot* const s = &tbl->slots[idx];
+
+        if (!s->key_len ||
+            (s->hash == h && s->key_len == len &&
+             !memcmp(tbl->strs + s->key_off, sym, len))) {
+            return idx;
+        }
+    }
+}
+
+/* doubles the number of slots and re-places every entry */
+static bool grow(sym_tbl* const tbl) {
+    slot* const old_slots = tbl->slots;
+    const uint32_t old_cap = tbl->cap;
+
+    slot* slots = (slot*)calloc((size_t)old_cap * 2, sizeof(slot));
+    if (!slots) {
+        return false;
+    }
+
+    tbl->slots = slots;
+    tbl->cap = old_cap * 2;
+    ++tbl->nallocs;
+
+    const uint32_t mask = tbl->cap - 1;
+
+    for (uint32_t i = 0; i < old_cap; ++i) {
+        if (!old_slots[i].key_len) {
+            continue;
+        }
 
-    for (uint16_t i = 0; i < exp; ++i) {
-        result *= base;
+        /* keys are unique, so no need to compare - just find a free slot */
+        uint32_t idx = old_slots[i].hash & mask;
+        while (tbl->slots[idx].key_len) {
+            idx = (idx + 1) & mask;
+        }
+        tbl->slots[idx] = old_slots[i];
     }
 
-    return result;
+    free(old_slots);
+    return true;
 }
 
-static uint16_t hash(const char* const sym) {
-    /* polynomial rolling hash
-     * [https://cp-algorithms.com/string/string-hashing.html] */
+/* copies a key into the string arena, returns its offset */
+static bool intern(sym_tbl* const tbl, const char* const sym, const size_t len,
+                   uint32_t* const off) {
+    if (tbl->strs_len + len > tbl->strs_cap) {
+        size_t cap = tbl->strs_cap;
+        while (tbl->strs_len + len > cap) {
+            cap *= 2;
+        }
 
-    uint16_t hash = 0;
-    const uint16_t p = 67; /* prime number closest to our alphabet size */
+        char* strs = realloc(tbl->strs, cap);
+        if (!strs) {
+            return false;
+        }
 
-    for (size_t i = 0; i < strlen(sym); ++i) {
-        hash += (uint16_t)(sym[i] * powu16(p, (uint16_t)i));
+        tbl->strs = strs;
+        tbl->strs_cap = cap;
+        ++tbl->nallocs;
     }
 
-    return hash % TBL_CAP;
+    memcpy(tbl->strs + tbl->strs_len, sym, len);
+    *off = (uint32_t)tbl->strs_len;
+    tbl->strs_len += len;
+
+    return true;
 }
 
 bool sym_tbl_insert(sym_tbl* const tbl, const char* const sym,
-                    const uint16_t addr) {
+                    const size_t len, const uint16_t addr) {
+    if (!tbl || !sym || !len) {
+        return false;
+    }
+
+    const uint32_t h = hash(sym, len);
+    uint32_t idx = probe(tbl, sym, len, h);
+
     /* note that we don't allow duplicate keys (obv) */
-    if (!tbl || !sym || sym_tbl_lookup(tbl, sym) != SYM_TBL_NPOS) {
+    if (tbl->slots[idx].key_len) {
         return false;
     }
 
-    /* create the new bucket */
-    bucket* b = malloc(sizeof(bucket));
-    b->symbol = malloc(strlen(sym) + 1);
-    strcpy(b->symbol, sym);
-    b->address = addr;
+    /* make room first, so the new entry is placed in the final table */
+    if (tbl->len + 1 > TBL_MAX_LOAD(tbl->cap)) {
+        if (!grow(tbl)) {
+            return false;
+        }
+        idx = probe(tbl, sym, len, h);
+    }
 
-    /* figure out where to put it */
-    uint16_t idx = hash(sym);
+    uint32_t key_off = 0;
+    if (!intern(tbl, sym, len, &key_off)) {
+        return false;
+    }
 
-    /* insert into table (chain on collisions) */
-    b->next = tbl->buckets[idx];
-    tbl->buckets[idx] = b;
+    tbl->slots[idx] = (slot){h, key_off, (uint32_t)len, addr};
+    ++tbl->len;
 
     return true;
 }
 
-uint16_t sym_tbl_lookup(const sym_tbl* const tbl, const char* const sym) {
-    if (!tbl || !sym) {
+uint16_t sym_tbl_lookup(const sym_tbl* const tbl, const char* const sym,
+                        const size_t len) {
+    if (!tbl || !sym || !len) {
         return SYM_TBL_NPOS;
     }
 
-    uint16_t idx = hash(sym);
+    const slot* const s = &tbl->slots[probe(tbl, sym, len, hash(sym, len))];
 
-    /* scan linked list for matching symbol */
-    bucket* tmp = tbl->buckets[idx];
-    while (tmp && strcmp(tmp->symbol, sym) != 0) {
-        tmp = tmp->next;
+    /* reached an empty slot before finding a match */
+    if (!s->key_len) {
+        return SYM_TBL_NPOS;
     }
 
-    /* reached end of list before finding match */
-    if (!tmp) {
-        return SYM_TBL_NPOS;
+    return s->address;
+}
+
+void sym_tbl_get_stats(const sym_tbl* const tbl, sym_tbl_stats* const stats) {
+    *stats = (sym_tbl_stats){0, 0, 0, 0};
+
+    if (!tbl) {
+        return;
     }
 
-    return tmp->address;
+    stats->len = tbl->len;
+    stats->cap = tbl->cap;
+    stats->nallocs = tbl->nallocs;
+
+    const uint32_t mask = tbl->cap - 1;
+
+    /* a symbol is found after looking at every slot from its home slot on */
+    for (uint32_t idx = 0; idx < tbl->cap; ++idx) {
+        const slot* const s = &tbl->slots[idx];
+        if (!s->key_len) {
+            continue;
+        }
+
+        const size_t nprobes = ((idx - (s->hash & mask)) & mask) + 1;
+        if (nprobes > stats->longest_probe) {
+            stats->longest_probe = nprobes;
+        }
+    }
 }
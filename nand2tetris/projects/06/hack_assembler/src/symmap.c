@@ -0,0 +1,113 @@
+/**
+ * @file symmap.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/05/2024
+ *
+ * @brief This file is part of the HackAssember program, an assembler for the
+ * Hack architecture, as described in "The Elements of Computing Systems", 2nd
+ * Ed. by Nisan and Schocken. This module writes symbol maps: where each label
+ * and variable of an assembled program ended up, and which source line each
+ * machine word came from, for profilers and debuggers to look addresses up in.
+ *
+ * @copyright Vincent Marias, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h> // for uint32_t
+#include <stdlib.h> // for malloc, free, qsort
+#include <string.h> // for memcpy, memcmp
+
+#include "symmap.h"
+#include "translator.h"
+
+/* bytes taken by each entry in the label and variable tables */
+static const size_t ENTRY_LEN = 12;
+
+/* orders labels before variables, then by address, then by name */
+static int cmp_symbols(const void* lhs, const void* rhs) {
+    const hackasm_symbol* const a = *(const hackasm_symbol* const*)lhs;
+    const hackasm_symbol* const b = *(const hackasm_symbol* const*)rhs;
+
+    if (a->kind != b->kind) {
+        return (a->kind == HACKASM_LABEL ? -1 : 1);
+    }
+    if (a->address != b->address) {
+        return (a->address < b->address ? -1 : 1);
+    }
+
+    const size_t len = (a->len < b->len ? a->len : b->len);
+    const int cmp = memcmp(a->name, b->name, len);
+    if (cmp) {
+        return cmp;
+    }
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+char* symmap_render(const hackasm_result* const result, size_t* const len) {
+    char* out = NULL;
+
+    const hackasm_symbol** const sorted =
+        malloc((result->nsymbols + 1) * sizeof(hackasm_symbol*));
+    if (!sorted) {
+        return NULL;
+    }
+
+    size_t nlabels = 0;
+    size_t strs_len = 0;
+
+    for (size_t i = 0; i < result->nsymbols; ++i) {
+        sorted[i] = &result->symbols[i];
+        nlabels += (result->symbols[i].kind == HACKASM_LABEL);
+        strs_len += result->symbols[i].len;
+    }
+
+    qsort(sorted, result->nsymbols, sizeof(hackasm_symbol*), cmp_symbols);
+
+    const size_t nlines = (result->lines ? result->nwords : 0);
+    *len = SYM_HEADER_LEN + ENTRY_LEN * result->nsymbols + 4 * nlines +
+           strs_len;
+
+    out = malloc(*len);
+    if (!out) {
+        goto EXIT;
+    }
+
+    unsigned char* const header = (unsigned char*)out;
+    unsigned char* const body = header + SYM_HEADER_LEN;
+    unsigned char* p = body;
+
+    /* the string table goes last, names are placed in table order */
+    char* const strs = out + *len - strs_len;
+    uint32_t strs_off = 0;
+
+    for (size_t i = 0; i < result->nsymbols; ++i, p += ENTRY_LEN) {
+        const hackasm_symbol* const sym = sorted[i];
+
+        translate_put_le32(p, sym->address);
+        translate_put_le32(p + 4, strs_off);
+        translate_put_le32(p + 8, (uint32_t)sym->len);
+
+        memcpy(strs + strs_off, sym->name, sym->len);
+        strs_off += (uint32_t)sym->len;
+    }
+
+    for (size_t i = 0; i < nlines; ++i, p += 4) {
+        translate_put_le32(p, result->lines[i]);
+    }
+
+    memcpy(header, SYM_MAGIC, 4);
+    translate_put_le16(header + 4, SYM_VERSION);
+    translate_put_le16(header + 6, SYM_HEADER_LEN);
+    translate_put_le32(header + 8, (uint32_t)nlabels);
+    translate_put_le32(header + 12, (uint32_t)(result->nsymbols - nlabels));
+    translate_put_le32(header + 16, (uint32_t)nlines);
+    translate_put_le32(header + 20, (uint32_t)strs_len);
+    translate_put_le32(header + 24,
+                       translate_crc32(body, *len - SYM_HEADER_LEN));
+    translate_put_le32(header + 28, 0);
+
+EXIT:
+    free(sorted);
+
+    return out;
+}
@@ -1,233 +1,213 @@
 /**
- * @file sym_tbl.c
+ * @file translator.c
  * @author Vincent Marias <vmarias@mines.edu>
  * @date 03/05/2024
  *
  * @brief This file is part of the HackAssember program, an assembler for the
  * Hack architecture, as described in "The Elements of Computing Systems", 2nd
  * Ed. by Nisan and Schocken. This module handles translating instruction
- * op-codes and value fields to their binary equivalents in the form of
- * character strings of the ASCII characters '0' and '1'.
+ * op-codes and value fields to their binary equivalents, and rendering the
+ * resulting machine words as character strings of the ASCII characters '0'
+ * and '1'.
  *
  * @copyright Vincent Marias, 2024
  */
 
 #define _POSIX_C_SOURCE 200809L
-#include <stddef.h> // for NULL
-#include <string.h> // for strlen, size_t
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t
+#include <string.h>  // for memcmp, memcpy
 
 #include "translator.h"
 
-char* translate_dest(const char* const dest) {
+const uint16_t TRANSLATE_ERR = UINT16_MAX;
+
+/* bit positions of the fields within a C-instruction */
+enum { COMP_SHIFT = 6, DEST_SHIFT = 3, JUMP_SHIFT = 0 };
+
+typedef struct mnemonic {
+    char str[5];
+    uint16_t bits; /* field value, not yet shifted into position */
+} mnemonic;
+
+/* every comp mnemonic, placed at its (collision-free) hash - see comp_hash */
+static const mnemonic COMP_TBL[64] = {
+    [1] = {"A", 0x30},    [4] = {"D", 0x0C},    [5] = {"A+1", 0x37},
+    [6] = {"D&M", 0x40},  [7] = {"-M", 0x73},   [8] = {"D+1", 0x1F},
+    [9] = {"A-1", 0x32},  [10] = {"D|A", 0x15}, [12] = {"D-1", 0x0E},
+    [13] = {"M", 0x70},   [15] = {"-1", 0x3A},  [16] = {"D+M", 0x42},
+    [17] = {"M+1", 0x77}, [19] = {"A-D", 0x07}, [20] = {"D-M", 0x53},
+    [21] = {"M-1", 0x72}, [30] = {"D&A", 0x00}, [31] = {"M-D", 0x47},
+    [35] = {"!A", 0x31},  [40] = {"D+A", 0x02}, [41] = {"!D", 0x0D},
+    [44] = {"D-A", 0x13}, [47] = {"-A", 0x33},  [48] = {"0", 0x2A},
+    [49] = {"1", 0x3F},   [50] = {"D|M", 0x55}, [53] = {"-D", 0x0F},
+    [59] = {"!M", 0x71},
+};
+
+/* every jump mnemonic, placed at its (collision-free) hash - see jump_hash */
+static const mnemonic JUMP_TBL[16] = {
+    [0] = {"JLE", 6}, [2] = {"JNE", 5},  [5] = {"null", 0}, [7] = {"JGT", 1},
+    [9] = {"JEQ", 2}, [11] = {"JGE", 3}, [12] = {"JLT", 4}, [13] = {"JMP", 7},
+};
+
+/* dest bits contributed by each register */
+static const uint16_t DEST_BITS[256] = {['A'] = 4, ['D'] = 2, ['M'] = 1};
+
+/* a perfect hash over the 28 comp mnemonics (found by exhaustive search) */
+static size_t comp_hash(const char* const comp, const size_t len) {
+    const unsigned c0 = (unsigned char)comp[0];
+    const unsigned c1 = (len > 1 ? (unsigned char)comp[1] : 0);
+    const unsigned c2 = (len > 2 ? (unsigned char)comp[2] : 0);
+
+    return (c0 + 2 * c1 + 14 * c2) % 64;
+}
+
+/* a perfect hash over the 8 jump mnemonics (all have length 3 or 4) */
+static size_t jump_hash(const char* const jump) {
+    const unsigned c1 = (unsigned char)jump[1];
+    const unsigned c2 = (unsigned char)jump[2];
+
+    return (size_t)((c1 + 4 * c2) % 16);
+}
+
+/* does the table entry hold exactly this mnemonic? */
+static bool is_mnemonic(const mnemonic* const m, const char* const str,
+                        const size_t len) {
+    return len < sizeof(m->str) && !m->str[len] && !memcmp(m->str, str, len);
+}
+
+uint16_t translate_dest(const char* const dest, const size_t len) {
     if (!dest) {
-        return NULL;
+        return TRANSLATE_ERR;
     }
 
     /* default for empty string */
-    if (strlen(dest) == 0) {
-        return "000";
+    if (len == 0 || (len == 4 && !memcmp(dest, "null", 4))) {
+        return 0;
     }
 
-    switch (strlen(dest)) {
-    case 1:
-        switch (dest[0]) {
-        case 'A':
-            return "100";
-        case 'D':
-            return "010";
-        case 'M':
-            return "001";
-        }
-        break;
-    case 2:
-        switch (dest[0]) {
-        case 'A':
-            switch (dest[1]) {
-            case 'M':
-                return "101";
-            case 'D':
-                return "110";
-            }
-            break;
-        case 'D':
-            return "011";
+    uint16_t bits = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        const uint16_t bit = DEST_BITS[(unsigned char)dest[i]];
+
+        /* unknown or repeated register */
+        if (!bit || (bits & bit)) {
+            return TRANSLATE_ERR;
         }
-        break;
-    case 3:
-        return "111";
-    case 4:
-        return "000";
+        bits |= bit;
     }
 
-    return NULL;
+    return (uint16_t)(bits << DEST_SHIFT);
 }
 
-char* translate_comp(const char* const comp) {
-    if (!comp || strlen(comp) == 0) {
-        return NULL;
+uint16_t translate_comp(const char* const comp, const size_t len) {
+    if (!comp || len == 0 || len > 3) {
+        return TRANSLATE_ERR;
     }
 
-    switch (strlen(comp)) {
-    case 1:
-        switch (comp[0]) {
-        case '0':
-            return "0101010";
-        case '1':
-            return "0111111";
-        case 'D':
-            return "0001100";
-        case 'A':
-            return "0110000";
-        case 'M':
-            return "1110000";
-        }
-        break;
-    case 2:
-        switch (comp[0]) {
-        case '-':
-            switch (comp[1]) {
-            case '1':
-                return "0111010";
-            case 'D':
-                return "0001111";
-            case 'A':
-                return "0110011";
-            case 'M':
-                return "1110011";
-            }
-            break;
-        case '!':
-            switch (comp[1]) {
-            case 'D':
-                return "0001101";
-            case 'A':
-                return "0110001";
-            case 'M':
-                return "1110001";
-            }
-        }
-        break;
-    case 3:
-        switch (comp[0]) {
-        case 'D':
-            switch (comp[1]) {
-            case '+':
-                switch (comp[2]) {
-                case '1':
-                    return "0011111";
-                case 'A':
-                    return "0000010";
-                case 'M':
-                    return "1000010";
-                }
-                break;
-            case '-':
-                switch (comp[2]) {
-                case '1':
-                    return "0001110";
-                case 'A':
-                    return "0010011";
-                case 'M':
-                    return "1010011";
-                }
-                break;
-            case '&':
-                switch (comp[2]) {
-                case 'A':
-                    return "0000000";
-                case 'M':
-                    return "1000000";
-                }
-                break;
-            case '|':
-                switch (comp[2]) {
-                case 'A':
-                    return "0010101";
-                case 'M':
-                    return "1010101";
-                }
-            }
-            break;
-        case 'A':
-            switch (comp[1]) {
-            case '+':
-                return "0110111";
-            case '-':
-                switch (comp[2]) {
-                case '1':
-                    return "0110010";
-                case 'D':
-                    return "0000111";
-                }
-            }
-            break;
-        case 'M':
-            switch (comp[1]) {
-            case '+':
-                return "1110111";
-            case '-':
-                switch (comp[2]) {
-                case '1':
-                    return "1110010";
-                case 'D':
-                    return "1000111";
-                }
-            }
-        }
+    const mnemonic* const m = &COMP_TBL[comp_hash(comp, len)];
+
+    if (!is_mnemonic(m, comp, len)) {
+        return TRANSLATE_ERR;
     }
 
-    return NULL;
+    return (uint16_t)(m->bits << COMP_SHIFT);
 }
 
-char* translate_jump(const char* const jump) {
+uint16_t translate_jump(const char* const jump, const size_t len) {
     if (!jump) {
-        return NULL;
+        return TRANSLATE_ERR;
     }
 
     /* default for empty string */
-    if (strlen(jump) == 0) {
-        return "000";
+    if (len == 0) {
+        return 0;
     }
 
-    switch (jump[0]) {
-    case 'n':
-        return "000";
-    default:
-        switch (jump[1]) {
-        case 'G':
-            switch (jump[2]) {
-            case 'T':
-                return "001";
-            case 'E':
-                return "011";
-            }
-            break;
-        case 'E':
-            return "010";
-        case 'L':
-            switch (jump[2]) {
-            case 'T':
-                return "100";
-            case 'E':
-                return "110";
-            }
-            break;
-        case 'N':
-            return "101";
-        case 'M':
-            return "111";
-        }
+    if (len < 3 || len > 4) {
+        return TRANSLATE_ERR;
     }
 
-    return NULL;
+    const mnemonic* const m = &JUMP_TBL[jump_hash(jump)];
+
+    if (!is_mnemonic(m, jump, len)) {
+        return TRANSLATE_ERR;
+    }
+
+    return (uint16_t)(m->bits << JUMP_SHIFT);
 }
 
+/* the ASCII binary digits of every nibble, most significant bit first */
+static const char NIBBLE_BITS[16][4] = {
+    {'0', '0', '0', '0'}, {'0', '0', '0', '1'}, {'0', '0', '1', '0'},
+    {'0', '0', '1', '1'}, {'0', '1', '0', '0'}, {'0', '1', '0', '1'},
+    {'0', '1', '1', '0'}, {'0', '1', '1', '1'}, {'1', '0', '0', '0'},
+    {'1', '0', '0', '1'}, {'1', '0', '1', '0'}, {'1', '0', '1', '1'},
+    {'1', '1', '0', '0'}, {'1', '1', '0', '1'}, {'1', '1', '1', '0'},
+    {'1', '1', '1', '1'},
+};
+
 void translate_val(const uint16_t val, char str[16]) {
-    uint16_t rest = val;
+    /* bits do be backward tho - most significant nibble goes first */
+    memcpy(str, NIBBLE_BITS[(val >> 12) & 0xF], 4);
+    memcpy(str + 4, NIBBLE_BITS[(val >> 8) & 0xF], 4);
+    memcpy(str + 8, NIBBLE_BITS[(val >> 4) & 0xF], 4);
+    memcpy(str + 12, NIBBLE_BITS[val & 0xF], 4);
+}
+
+size_t translate_render(const uint16_t* const words, const size_t nwords,
+                        char* const out) {
+    char* curr = out;
+
+    for (size_t i = 0; i < nwords; ++i) {
+        translate_val(words[i], curr);
+        curr[16] = '\n';
+        curr += TRANSLATE_LINE_LEN;
+    }
+
+    return (size_t)(curr - out);
+}
+
+/* bitwise CRC-32 with the reflected IEEE polynomial */
+uint32_t translate_crc32(const unsigned char* const data, const size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+
+    return ~crc;
+}
+
+void translate_put_le16(unsigned char* const out, const uint16_t val) {
+    out[0] = (unsigned char)(val & 0xFF);
+    out[1] = (unsigned char)(val >> 8);
+}
 
-    for (size_t i = 0; i < 16; ++i) {
-        size_t j = 15 - i; /* bits do be backward tho */
-        str[j] = (rest % 2 ? '1' : '0');
-        rest /= 2;
+void translate_put_le32(unsigned char* const out, const uint32_t val) {
+    translate_put_le16(out, (uint16_t)(val & 0xFFFF));
+    translate_put_le16(out + 2, (uint16_t)(val >> 16));
+}
+
+size_t translate_render_rom(const uint16_t* const words, const size_t nwords,
+                            char* const out) {
+    unsigned char* const header = (unsigned char*)out;
+    unsigned char* const body = header + ROM_HEADER_LEN;
+
+    for (size_t i = 0; i < nwords; ++i) {
+        translate_put_le16(body + 2 * i, words[i]);
     }
+
+    memcpy(header, ROM_MAGIC, 4);
+    translate_put_le16(header + 4, ROM_VERSION);
+    translate_put_le16(header + 6, ROM_HEADER_LEN);
+    translate_put_le32(header + 8, (uint32_t)nwords);
+    translate_put_le32(header + 12, translate_crc32(body, 2 * nwords));
+
+    return ROM_HEADER_LEN + 2 * nwords;
 }
@@ -0,0 +1,60 @@
+// File name: DeadCode.asm
+
+// Exercises dead code elimination (-O2): DOUBLE is called with its return
+// address stashed in R15, TRIPLE is never called, and the LOOP label is
+// never jumped to. Afterwards, R2 picks an entry of TABLE to jump through;
+// only the first entry is reached without counting from TABLE, but every one
+// of them, and the code they jump to, has to be kept.
+
+@R0
+D=M
+@RET
+D=A
+@R15
+M=D
+@DOUBLE
+0;JMP
+(RET)
+(LOOP)
+@TABLE
+D=A
+@R2
+D=D+M
+D=D+M
+A=D
+0;JMP
+
+(TRIPLE)
+@R0
+D=M
+D=D+M
+D=D+M
+@R1
+M=D
+@R15
+A=M
+0;JMP
+
+(DOUBLE)
+@R0
+D=M
+D=D+M
+@R1
+M=D
+@R15
+A=M
+0;JMP
+
+(TABLE)
+@END
+0;JMP
+@NEGATE
+0;JMP
+
+(NEGATE)
+@R1
+M=-M
+
+(END)
+@END
+0;JMP
@@ -0,0 +1,13 @@
+// File name: LinkA.asm
+
+// Linked before LinkB.asm, which defines L again: this definition is the one
+// that counts, even in LinkB's own jump to L, so R1 ends up 1.
+
+@MAIN
+0;JMP
+(L)
+@R1
+M=1
+(HALT)
+@HALT
+0;JMP
@@ -0,0 +1,17 @@
+// File name: LinkB.asm
+
+// Linked after LinkA.asm. Its own L only jumps on to M2, but that L is never
+// used, so the jump to L must not be sent to M2 (-c -O).
+
+(MAIN)
+@L
+0;JMP
+(L)
+@M2
+0;JMP
+(M2)
+@R1
+M=-1
+(HALT2)
+@HALT2
+0;JMP
@@ -0,0 +1,57 @@
+// File name: Peephole.asm
+
+// Exercises the peephole optimizer (-O): redundant loads of i, code after
+// the unconditional jumps, and the jumps to END, which only jumps on to
+// DISPATCH by way of FIN. DISPATCH jumps through a table indexed by R0, whose
+// entries have no labels of their own and must all be kept as they are.
+
+@i
+M=1
+@i
+D=M
+@i
+M=D+1
+(LOOP)
+@END
+D;JGT
+@x
+M=0
+@END
+0;JMP
+@x
+M=0
+D=M
+(END)
+@FIN
+0;JMP
+(FIN)
+@DISPATCH
+0;JMP
+@FIN
+0;JMP
+(DISPATCH)
+@TABLE
+D=A
+@R0
+D=D+M
+D=D+M
+A=D
+0;JMP
+(TABLE)
+@CASE0
+0;JMP
+@CASE1
+0;JMP
+@CASE1
+0;JMP
+(CASE0)
+@R1
+M=1
+@HALT
+0;JMP
+(CASE1)
+@R1
+M=-1
+(HALT)
+@HALT
+0;JMP
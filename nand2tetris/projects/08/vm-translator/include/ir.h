@@ -0,0 +1,103 @@
+/**
+ * @file ir.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/19/2024
+ *
+ * @desc This file is part of the VMTranslator program. This module holds a
+ * whole VM program in memory: every command of every input file, split up by
+ * function, with label and function names interned so that commands are small
+ * and names can be compared by index. Code is generated from here once all of
+ * the input has been read, so passes can look at more than one command.
+ *
+ * @copyright Vincent Marias 2024
+ */
+
+#ifndef VM_TRANSLATOR_IR_H
+#define VM_TRANSLATOR_IR_H
+
+/* standard library headers */
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> /* for bool */
+#include <stddef.h>  /* for size_t */
+#include <stdint.h>  /* for int16_t, uint32_t */
+
+/* project-specific modules */
+#include "parser.h"
+
+/* >>>>>>>>>>>>>>>>>>> */
+/* Types and Constants */
+/* <<<<<<<<<<<<<<<<<<< */
+
+/* a single VM command; same as the parser's, but labels are name indices */
+struct ir_cmd {
+    enum cmd_t command;
+    union {
+        enum op_t operation;
+        enum seg_t segment;
+        uint32_t label; /* index into the program's names */
+    } arg1;
+    int16_t arg2; /* optional */
+};
+
+/* a run of commands belonging to one function, from one file */
+struct ir_func {
+    uint32_t file; /* path of the file, as a name index */
+    uint32_t name; /* the function, or "GLOBAL" for code before the first */
+    size_t first;  /* index of the first command (the function command) */
+    size_t ncmds;
+};
+
+/* a whole VM program */
+struct ir {
+    struct ir_cmd* cmds; /* every command, in input order */
+    size_t ncmds, cmds_cap;
+
+    struct ir_func* funcs; /* functions, in input order */
+    size_t nfuncs, funcs_cap;
+
+    char** names; /* interned strings, by index */
+    size_t nnames, names_cap;
+
+    uint32_t* slots; /* hash table of names: index + 1, or 0 if empty */
+    size_t nslots;
+};
+
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/* (Public) Subroutine Declarations */
+/* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+/**
+ * @desc Creates a new, empty program.
+ *
+ * @return pointer to newly allocated program, or NULL on error
+ *
+ * @note The returned program should be freed with ir_free by the caller.
+ */
+struct ir* ir_alloc(void);
+
+/**
+ * @desc Frees the memory associated with a program.
+ *
+ * @param[out] ir pointer to a program previously allocated using ir_alloc
+ */
+void ir_free(struct ir* const ir);
+
+/**
+ * @desc Parses a .vm file and appends its commands to the program.
+ *
+ * @param[in,out] ir pointer to a program to add to
+ * @param[in] fpath path to the file to be parsed
+ * @return true on success, false on error
+ */
+bool ir_add_file(struct ir* const ir, const char* const fpath);
+
+/**
+ * @desc Looks up an interned name.
+ *
+ * @param[in] ir pointer to the program the name belongs to
+ * @param[in] idx index of the name
+ * @return the name, owned by the program
+ */
+const char* ir_name(const struct ir* const ir, const uint32_t idx);
+
+#endif /* VM_TRANSLATOR_IR_H */
@@ -0,0 +1,39 @@
+/**
+ * @file optimizer.h
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/19/2024
+ *
+ * @desc This file is part of the VMTranslator program. This module rewrites a
+ * whole VM program (see `ir.h`) into an equivalent one that takes fewer Hack
+ * instructions, before any code is generated for it.
+ *
+ * @copyright Vincent Marias 2024
+ */
+
+#ifndef VM_TRANSLATOR_OPTIMIZER_H
+#define VM_TRANSLATOR_OPTIMIZER_H
+
+/* standard library headers */
+#define _POSIX_C_SOURCE 200809L
+
+/* project-specific modules */
+#include "ir.h"
+
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/* (Public) Subroutine Declarations */
+/* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+/**
+ * @desc Folds arithmetic-logical commands on constants into the constant they
+ * compute (push constant 3, push constant 4, add -> push constant 7), and
+ * drops commands that leave their operand as it was (push constant 0, add; not,
+ * not). Folded constants may be negative, and must be written out with
+ * writer_put_const.
+ *
+ * @param[in,out] ir the program to rewrite
+ *
+ * @note Labels are never folded across, since code could jump in between.
+ */
+void optimize_fold(struct ir* const ir);
+
+#endif /* VM_TRANSLATOR_OPTIMIZER_H */
@@ -27,6 +27,21 @@
 /* handles the memory associated with a single open input stream */
 struct writer;
 
+/* code generation strategies, or'd together */
+enum mode_t {
+    M_DEFAULT = 0,
+    M_IN_PLACE = 1 << 0, /* arithmetic-logical commands work on the stack top
+                            where it is, rather than popping it into D */
+    M_CACHE_TOS = 1 << 1, /* the stack top is kept in D from one command to
+                             the next, and only written back to RAM at labels,
+                             jumps, calls and returns; overrides M_IN_PLACE */
+    M_SHARED_CALLS = 1 << 2, /* calls and returns jump to routines shared by
+                                the whole program (see writer_put_shared)
+                                instead of being written out in full at every
+                                use */
+    M_SHARED_COMPARE = 1 << 3 /* so do eq, lt and gt */
+};
+
 /* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
 /* (Public) Subroutine Declarations */
 /* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
@@ -35,12 +50,13 @@ struct writer;
  * @desc Creates a new Writer by opening the given file.
  *
  * @param[in] fpath path to the file to be opened
+ * @param[in] mode code generation strategies to use, see mode_t
  * @return pointer to newly allocated Writer, or NULL on error
  *
  * @note The argument to fpath can be a regular file or a stream.
  * @note The returned Writer should be freed with writer_free by the caller.
  */
-struct writer* writer_alloc(const char* const fpath);
+struct writer* writer_alloc(const char* const fpath, const unsigned mode);
 
 /**
  * @desc Frees the memory associated with a Writer. Additionally closes the
@@ -53,6 +69,17 @@ struct writer* writer_alloc(const char* const fpath);
  */
 void writer_free(struct writer* const wtr);
 
+/**
+ * @desc Writes out any output still held by a Writer. Output is collected in
+ * memory and written a block at a time, so this is also where errors writing
+ * the file show up.
+ *
+ * @param[in,out] wtr pointer to a Writer previously allocated using
+ * writer_alloc
+ * @return true if all output so far has been written, false on error
+ */
+bool writer_flush(struct writer* const wtr);
+
 /**
  * @desc Sets the name of the file currently being parsed. Used for labels
  * within the in generated code.
@@ -85,6 +112,16 @@ bool writer_put_al(struct writer* const wtr, const enum op_t op);
 bool writer_put_so(struct writer* const wtr, const enum cmd_t cmd_type,
                    const enum seg_t seg, const int16_t idx);
 
+/**
+ * @desc Writes to the output file the assembly code that pushes a constant,
+ * which unlike the index of a push command may be negative.
+ *
+ * @param[out] wtr pointer to a Writer previously allocated using writer_alloc
+ * @param[in] val the value to push
+ * @return true on success, false on error
+ */
+bool writer_put_const(struct writer* const wtr, const int16_t val);
+
 /**
  * @desc Writes assembly code that effects one of the branching commands (label,
  * goto, if-goto).
@@ -97,6 +134,21 @@ bool writer_put_so(struct writer* const wtr, const enum cmd_t cmd_type,
 bool writer_put_branch(struct writer* const wtr, const enum cmd_t cmd_type,
                        const char* const label);
 
+/**
+ * @desc Writes assembly code for a test followed by if-goto, jumping on the
+ * test itself rather than on a true or false pushed for if-goto to pop again.
+ *
+ * @param[out] wtr pointer to a Writer previously allocated using writer_alloc
+ * @param[in] test one of O_EQ, O_LT, O_GT (eq, lt, gt; if-goto label), or O_NOT
+ * (not; if-goto label)
+ * @param[in] negated if the test is followed by a not before the if-goto; not
+ * allowed for O_NOT
+ * @param[in] label a string representing the label name given in the VM code
+ * @return true on success, false on error
+ */
+bool writer_put_cond(struct writer* const wtr, const enum op_t test,
+                     const bool negated, const char* const label);
+
 /**
  * @desc Writes assembly code that effects a function definition command
  *
@@ -129,4 +181,17 @@ bool writer_put_return(struct writer* const wtr);
 bool writer_put_call(struct writer* const wtr, const char* const label,
                      const int16_t nargs);
 
+/**
+ * @desc Writes the routines shared by calls and returns under M_SHARED_CALLS,
+ * and by comparisons under M_SHARED_COMPARE, those of them that the program
+ * has used. Does nothing otherwise.
+ *
+ * @param[out] wtr pointer to a Writer previously allocated using writer_alloc
+ * @return true on success, false on error
+ *
+ * @note The routines are placed where this is called, so it should be called
+ * once the whole program has been written, and not again.
+ */
+bool writer_put_shared(struct writer* const wtr);
+
 #endif /* VM_TRANSLATOR_WRITER_H */
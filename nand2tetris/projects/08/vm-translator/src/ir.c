@@ -0,0 +1,259 @@
+/**
+ * @file ir.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/19/2024
+ *
+ * @desc This file is part of the VMTranslator program. See `ir.h` for more
+ * details.
+ *
+ * @copyright Vincent Marias 2024
+ */
+
+/* standard library headers */
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> /* for bool, true, false */
+#include <stddef.h>  /* for NULL, size_t */
+#include <stdint.h>  /* for uint32_t, UINT32_MAX */
+#include <stdio.h>   /* for fprintf, stderr, perror */
+#include <stdlib.h>  /* for calloc, realloc, free */
+#include <string.h>  /* for strlen, strcpy, strcmp */
+
+/* project-specific modules */
+#include "ir.h"
+#include "parser.h"
+
+/* >>>>>>>>>>>>>>>>>>> */
+/* Types and Constants */
+/* <<<<<<<<<<<<<<<<<<< */
+
+/* returned by intern when out of memory */
+static const uint32_t NAME_ERROR = UINT32_MAX;
+
+/* code before the first function in a file is credited to this */
+static const char* const default_func = "GLOBAL";
+
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/* (Private) Subroutine Definitions */
+/* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+/* FNV-1a, 32-bit */
+static uint32_t hash(const char* str) {
+    uint32_t h = 2166136261u;
+
+    for (; *str; ++str) {
+        h = (h ^ (unsigned char)*str) * 16777619u;
+    }
+
+    return h;
+}
+
+/* doubles the hash table, putting every name back in */
+static bool grow_slots(struct ir* const ir) {
+    const size_t nslots = (ir->nslots ? ir->nslots * 2 : 64);
+    uint32_t* slots = calloc(nslots, sizeof(*slots));
+    if (!slots) {
+        perror("[ERROR] calloc");
+        return false;
+    }
+
+    for (size_t i = 0; i < ir->nnames; ++i) {
+        size_t slot = hash(ir->names[i]) & (nslots - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (nslots - 1);
+        }
+        slots[slot] = (uint32_t)i + 1;
+    }
+
+    free(ir->slots);
+    ir->slots = slots;
+    ir->nslots = nslots;
+
+    return true;
+}
+
+/* index of a name, which is added if it hasn't been seen yet */
+static uint32_t intern(struct ir* const ir, const char* const name) {
+    /* keep the table at most half full */
+    if ((ir->nnames + 1) * 2 > ir->nslots && !grow_slots(ir)) {
+        return NAME_ERROR;
+    }
+
+    size_t slot = hash(name) & (ir->nslots - 1);
+    for (; ir->slots[slot]; slot = (slot + 1) & (ir->nslots - 1)) {
+        if (!strcmp(ir->names[ir->slots[slot] - 1], name)) {
+            return ir->slots[slot] - 1;
+        }
+    }
+
+    if (ir->nnames == ir->names_cap) {
+        const size_t cap = (ir->names_cap ? ir->names_cap * 2 : 32);
+        char** names = realloc(ir->names, cap * sizeof(*names));
+        if (!names) {
+            perror("[ERROR] realloc");
+            return NAME_ERROR;
+        }
+        ir->names = names;
+        ir->names_cap = cap;
+    }
+
+    char* copy = calloc(strlen(name) + 1, sizeof(*copy));
+    if (!copy) {
+        perror("[ERROR] calloc");
+        return NAME_ERROR;
+    }
+    strcpy(copy, name);
+
+    ir->names[ir->nnames] = copy;
+    ir->slots[slot] = (uint32_t)++ir->nnames;
+
+    return (uint32_t)(ir->nnames - 1);
+}
+
+/* starts a new function, taking the place of the last one if it's empty */
+static bool push_func(struct ir* const ir, const uint32_t file,
+                      const uint32_t name) {
+    if (ir->nfuncs && !ir->funcs[ir->nfuncs - 1].ncmds) {
+        --ir->nfuncs;
+    }
+
+    if (ir->nfuncs == ir->funcs_cap) {
+        const size_t cap = (ir->funcs_cap ? ir->funcs_cap * 2 : 16);
+        struct ir_func* funcs = realloc(ir->funcs, cap * sizeof(*funcs));
+        if (!funcs) {
+            perror("[ERROR] realloc");
+            return false;
+        }
+        ir->funcs = funcs;
+        ir->funcs_cap = cap;
+    }
+
+    ir->funcs[ir->nfuncs++] = (struct ir_func){file, name, ir->ncmds, 0};
+    return true;
+}
+
+/* appends a command to the current function */
+static bool push_cmd(struct ir* const ir, const struct ir_cmd cmd) {
+    if (ir->ncmds == ir->cmds_cap) {
+        const size_t cap = (ir->cmds_cap ? ir->cmds_cap * 2 : 256);
+        struct ir_cmd* cmds = realloc(ir->cmds, cap * sizeof(*cmds));
+        if (!cmds) {
+            perror("[ERROR] realloc");
+            return false;
+        }
+        ir->cmds = cmds;
+        ir->cmds_cap = cap;
+    }
+
+    ir->cmds[ir->ncmds++] = cmd;
+    ++ir->funcs[ir->nfuncs - 1].ncmds;
+
+    return true;
+}
+
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/* (Public) Subroutine Definitions */
+/* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+struct ir* ir_alloc(void) {
+    struct ir* ir = calloc(1, sizeof(*ir));
+    if (!ir) {
+        perror("[ERROR] calloc");
+    }
+
+    return ir;
+}
+
+void ir_free(struct ir* const ir) {
+    if (!ir) {
+        return;
+    }
+
+    for (size_t i = 0; i < ir->nnames; ++i) {
+        free(ir->names[i]);
+    }
+    free(ir->names);
+    free(ir->slots);
+    free(ir->funcs);
+    free(ir->cmds);
+
+    free(ir);
+}
+
+bool ir_add_file(struct ir* const ir, const char* const fpath) {
+    if (!ir || !fpath) {
+        fprintf(stderr,
+                "[WARNING] Calling %s with NULL argument(s), no operation "
+                "performed\n",
+                __func__);
+        return false;
+    }
+
+    const uint32_t file = intern(ir, fpath);
+    const uint32_t global = intern(ir, default_func);
+
+    if (file == NAME_ERROR || global == NAME_ERROR ||
+        !push_func(ir, file, global)) {
+        return false;
+    }
+
+    struct parser* psr = parser_alloc(fpath);
+    if (!psr) {
+        fprintf(stderr, "[ERROR] Could not create Parser\n");
+        return false;
+    }
+
+    bool ok = true;
+
+    while (ok && parser_has_lines(psr)) {
+        parser_advance(psr);
+
+        struct ir_cmd cmd = {parser_command_type(psr), {0}, 0};
+        const union arg_t arg1 = parser_arg1(psr);
+
+        switch (cmd.command) {
+        case C_ARITHMETIC:
+            cmd.arg1.operation = arg1.operation;
+            break;
+        case C_PUSH:
+        case C_POP:
+            cmd.arg1.segment = arg1.segment;
+            cmd.arg2 = parser_arg2(psr);
+            break;
+        case C_LABEL:
+        case C_GOTO:
+        case C_IF:
+            cmd.arg1.label = intern(ir, arg1.label);
+            ok = (cmd.arg1.label != NAME_ERROR);
+            break;
+        case C_FUNCTION:
+        case C_CALL:
+            cmd.arg1.label = intern(ir, arg1.label);
+            cmd.arg2 = parser_arg2(psr);
+            ok = (cmd.arg1.label != NAME_ERROR);
+            break;
+        case C_RETURN:
+            /* has no information associated with it */
+            break;
+        default:
+            fprintf(stderr, "[ERROR] I wasn't expecting that command type "
+                            "just yet :/\n");
+            ok = false;
+            break;
+        }
+
+        /* every function gets a run of commands of its own */
+        if (ok && cmd.command == C_FUNCTION) {
+            ok = push_func(ir, file, cmd.arg1.label);
+        }
+
+        ok = ok && push_cmd(ir, cmd);
+    }
+
+    parser_free(psr);
+
+    return ok;
+}
+
+const char* ir_name(const struct ir* const ir, const uint32_t idx) {
+    return ir->names[idx];
+}
@@ -0,0 +1,169 @@
+/**
+ * @file optimizer.c
+ * @author Vincent Marias <vmarias@mines.edu>
+ * @date 03/19/2024
+ *
+ * @desc This file is part of the VMTranslator program. See `optimizer.h` for
+ * more details.
+ *
+ * @copyright Vincent Marias 2024
+ */
+
+/* standard library headers */
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h> /* for bool, true, false */
+#include <stddef.h>  /* for size_t */
+#include <stdint.h>  /* for int16_t, uint16_t */
+
+/* project-specific modules */
+#include "ir.h"
+#include "optimizer.h"
+#include "parser.h"
+
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/* (Private) Subroutine Definitions */
+/* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+static bool is_const(const struct ir_cmd* const cmd) {
+    return cmd->command == C_PUSH && cmd->arg1.segment == S_CONSTANT;
+}
+
+static bool is_unary(const enum op_t op) {
+    return op == O_NEG || op == O_NOT;
+}
+
+/* true and false, as the VM represents them */
+static int16_t truth(const bool val) {
+    return (val ? -1 : 0);
+}
+
+/* what an operation on constants computes, wrapping around at 16 bits */
+static int16_t fold_unary(const enum op_t op, const int16_t y) {
+    switch (op) {
+    case O_NEG:
+        return (int16_t)(uint16_t)(0u - (uint16_t)y);
+    case O_NOT:
+        return (int16_t)~y;
+    default:
+        return y;
+    }
+}
+
+static int16_t fold_binary(const enum op_t op, const int16_t x,
+                           const int16_t y) {
+    /* comparisons are decided by the sign of x - y, as in the generated code,
+     * so folding never changes what a program does when that overflows */
+    const int16_t diff = (int16_t)(uint16_t)((uint16_t)x - (uint16_t)y);
+
+    switch (op) {
+    case O_ADD:
+        return (int16_t)(uint16_t)((uint16_t)x + (uint16_t)y);
+    case O_SUB:
+        return diff;
+    case O_AND:
+        return (int16_t)(x & y);
+    case O_OR:
+        return (int16_t)(x | y);
+    case O_EQ:
+        return truth(diff == 0);
+    case O_GT:
+        return truth(diff > 0);
+    case O_LT:
+        return truth(diff < 0);
+    default:
+        return x;
+    }
+}
+
+/* whether x <op> y is just x, whatever x is */
+static bool is_identity(const enum op_t op, const int16_t y) {
+    switch (op) {
+    case O_ADD:
+    case O_SUB:
+    case O_OR:
+        return y == 0;
+    case O_AND:
+        return y == -1;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @desc Simplifies the last few commands written so far, if they can be.
+ *
+ * @param[in,out] cmds commands of the function so far
+ * @param[in,out] ncmds number of commands, less any that were folded away
+ * @return true if anything was simplified, else false
+ */
+static bool fold_tail(struct ir_cmd* const cmds, size_t* const ncmds) {
+    const size_t n = *ncmds;
+
+    if (n < 2 || cmds[n - 1].command != C_ARITHMETIC) {
+        return false;
+    }
+
+    const enum op_t op = cmds[n - 1].arg1.operation;
+    struct ir_cmd* const y = &cmds[n - 2];
+
+    /* neg, neg and not, not cancel out */
+    if (!is_const(y)) {
+        if (is_unary(op) && y->command == C_ARITHMETIC &&
+            y->arg1.operation == op) {
+            *ncmds -= 2;
+            return true;
+        }
+        return false;
+    }
+
+    if (is_unary(op)) {
+        y->arg2 = fold_unary(op, y->arg2);
+        *ncmds -= 1;
+        return true;
+    }
+
+    if (is_identity(op, y->arg2)) {
+        *ncmds -= 2;
+        return true;
+    }
+
+    if (n >= 3 && is_const(&cmds[n - 3])) {
+        struct ir_cmd* const x = &cmds[n - 3];
+
+        x->arg2 = fold_binary(op, x->arg2, y->arg2);
+        *ncmds -= 2;
+        return true;
+    }
+
+    return false;
+}
+
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/* (Public) Subroutine Definitions */
+/* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+void optimize_fold(struct ir* const ir) {
+    /* commands only ever get removed, so the program is rewritten in place,
+     * closing up the gaps as it goes */
+    size_t out = 0;
+
+    for (size_t f = 0; f < ir->nfuncs; ++f) {
+        struct ir_func* const func = &ir->funcs[f];
+        struct ir_cmd* const cmds = &ir->cmds[out];
+        size_t ncmds = 0;
+
+        for (size_t i = func->first; i < func->first + func->ncmds; ++i) {
+            cmds[ncmds++] = ir->cmds[i];
+
+            /* folding may leave something else that can be folded */
+            while (fold_tail(cmds, &ncmds)) {
+            }
+        }
+
+        func->first = out;
+        func->ncmds = ncmds;
+        out += ncmds;
+    }
+
+    ir->ncmds = out;
+}
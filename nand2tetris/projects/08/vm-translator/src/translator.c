@@ -32,6 +32,8 @@
 #include <linux/limits.h> /* for PATH_MAX */
 
 /* project-specific modules */
+#include "ir.h"
+#include "optimizer.h"
 #include "parser.h"
 #include "writer.h"
 
@@ -41,33 +43,199 @@
 
 const char *const IN_EXT = "vm", *const OUT_EXT = "asm";
 
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/* (Private) Subroutine Definitions */
+/* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+static bool is_op(const struct ir_cmd* const cmd, const enum op_t op) {
+    return cmd->command == C_ARITHMETIC && cmd->arg1.operation == op;
+}
+
+/**
+ * @desc Checks whether a run of commands is a test that only decides an
+ * if-goto: eq, lt, gt or not, possibly followed by not, then if-goto.
+ *
+ * @param[in] cmds the commands, starting with the possible test
+ * @param[in] ncmds number of commands left in the function
+ * @param[out] test the test, one of O_EQ, O_LT, O_GT, O_NOT
+ * @param[out] negated whether the test is followed by not
+ * @return number of commands before the if-goto, or 0 if they aren't a test
+ */
+static size_t match_cond(const struct ir_cmd* const cmds, const size_t ncmds,
+                         enum op_t* const test, bool* const negated) {
+    if (!(is_op(&cmds[0], O_EQ) || is_op(&cmds[0], O_LT) ||
+          is_op(&cmds[0], O_GT) || is_op(&cmds[0], O_NOT))) {
+        return 0;
+    }
+
+    *test = cmds[0].arg1.operation;
+    *negated = (*test != O_NOT && ncmds > 2 && is_op(&cmds[1], O_NOT));
+
+    const size_t n = 1 + *negated;
+    return (n < ncmds && cmds[n].command == C_IF ? n : 0);
+}
+
+/**
+ * @desc Writes the assembly code for a whole program, one function at a time.
+ *
+ * @param[in] ir the program
+ * @param[out] wtr pointer to a Writer previously allocated using writer_alloc
+ * @param[in] fuse whether tests that decide an if-goto jump on the test itself
+ * @return true on success, false on error
+ */
+static bool translate(const struct ir* const ir, struct writer* const wtr,
+                      const bool fuse) {
+    for (size_t f = 0; f < ir->nfuncs; ++f) {
+        const struct ir_func* const func = &ir->funcs[f];
+
+        /* tell the writer that we're in a different file now */
+        if (!f || func->file != ir->funcs[f - 1].file) {
+            writer_set_fname(wtr, ir_name(ir, func->file));
+        }
+
+        const size_t end = func->first + func->ncmds;
+
+        for (size_t i = func->first; i < end; ++i) {
+            const struct ir_cmd* const cmd = &ir->cmds[i];
+
+            enum op_t test;
+            bool negated;
+            const size_t ntest =
+                (fuse ? match_cond(cmd, end - i, &test, &negated) : 0);
+
+            /* skip past the test and its if-goto */
+            if (ntest) {
+                i += ntest;
+                if (!writer_put_cond(wtr, test, negated,
+                                     ir_name(ir, ir->cmds[i].arg1.label))) {
+                    fprintf(stderr,
+                            "[ERROR] Could not write branching command\n");
+                    return false;
+                }
+                continue;
+            }
+
+            switch (cmd->command) {
+            case C_ARITHMETIC:
+                if (!writer_put_al(wtr, cmd->arg1.operation)) {
+                    fprintf(
+                        stderr,
+                        "[ERROR] Could not write arithmetic-logical command\n");
+                    return false;
+                }
+                break;
+            case C_PUSH:
+            case C_POP:
+                /* folded constants can be negative */
+                if (cmd->command == C_PUSH &&
+                    cmd->arg1.segment == S_CONSTANT) {
+                    if (!writer_put_const(wtr, cmd->arg2)) {
+                        fprintf(stderr,
+                                "[ERROR] Could not write stack command\n");
+                        return false;
+                    }
+                    break;
+                }
+
+                if (!writer_put_so(wtr, cmd->command, cmd->arg1.segment,
+                                   cmd->arg2)) {
+                    fprintf(stderr, "[ERROR] Could not write stack command\n");
+                    return false;
+                }
+                break;
+            case C_LABEL:
+            case C_GOTO:
+            case C_IF:
+                if (!writer_put_branch(wtr, cmd->command,
+                                       ir_name(ir, cmd->arg1.label))) {
+                    fprintf(stderr,
+                            "[ERROR] Could not write branching command\n");
+                    return false;
+                }
+                break;
+            case C_FUNCTION:
+                if (!writer_put_func(wtr, ir_name(ir, cmd->arg1.label),
+                                     cmd->arg2)) {
+                    fprintf(stderr,
+                            "[ERROR] Could not write function command\n");
+                    return false;
+                }
+                break;
+            case C_RETURN:
+                if (!writer_put_return(wtr)) {
+                    fprintf(stderr, "[ERROR] Could not write return command\n");
+                    return false;
+                }
+                break;
+            case C_CALL:
+                if (!writer_put_call(wtr, ir_name(ir, cmd->arg1.label),
+                                     cmd->arg2)) {
+                    fprintf(stderr, "[ERROR] Could not write call command\n");
+                    return false;
+                }
+                break;
+            default:
+                fprintf(stderr, "[ERROR] I wasn't expecting that command type "
+                                "just yet :/\n");
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 /* >>>>>>>>>>>>>>>>>>> */
 /* Program Entry Point */
 /* <<<<<<<<<<<<<<<<<<< */
 
 int main(int argc, char** argv) {
-    struct parser* psr = NULL;
+    struct ir* ir = NULL;
     struct writer* wtr = NULL;
     int EXIT_STATUS = EXIT_SUCCESS;
 
-    if (argc != 2) {
-        fprintf(stderr, "[ERROR] Usage: %s <path to file>.vm\n", argv[0]);
-        EXIT_STATUS = EXIT_FAILURE;
-        goto EXIT;
+    /* ------------- */
+    /* Parse Options */
+    /* ------------- */
+
+    /* -O  fold constant arithmetic, and generate faster code for what's left,
+     *     jumping on tests directly where they only decide an if-goto
+     * -Os call, return and compare through routines shared by the whole
+     *     program, for a smaller ROM at the cost of a few cycles each time */
+    bool optimize = false;
+    bool shared = false;
+    int first = 1;
+
+    for (; first < argc - 1; ++first) {
+        if (!strcmp(argv[first], "-O")) {
+            optimize = true;
+        } else if (!strcmp(argv[first], "-Os")) {
+            shared = true;
+        } else {
+            break;
+        }
+    }
+
+    if (first != argc - 1) {
+        fprintf(stderr, "[ERROR] Usage: %s [-O] [-Os] <path to file>.vm\n",
+                argv[0]);
+        return EXIT_FAILURE;
     }
 
+    char* const path = argv[first];
+
     /* ------------------- */
     /* Validate Input File */
     /* ------------------- */
 
     /* could have trailing /, or not */
-    if (*(argv[1] + strlen(argv[1]) - 1) == '/') {
-        argv[1][strlen(argv[1]) - 1] = '\0';
+    if (*(path + strlen(path) - 1) == '/') {
+        path[strlen(path) - 1] = '\0';
     }
 
     struct stat sb;
 
-    if (stat(argv[1], &sb) == -1) {
+    if (stat(path, &sb) == -1) {
         perror("[ERROR] stat");
         EXIT_STATUS = EXIT_FAILURE;
         goto EXIT;
@@ -75,8 +243,8 @@ int main(int argc, char** argv) {
 
     /* need the relative path prefix because readdir sucks ass */
     char* rel_path_prefix =
-        calloc(strlen(argv[1]) + 2, sizeof(*rel_path_prefix));
-    strcpy(rel_path_prefix, argv[1]);
+        calloc(strlen(path) + 2, sizeof(*rel_path_prefix));
+    strcpy(rel_path_prefix, path);
     strcat(rel_path_prefix, "/");
 
     bool input_dir = false;
@@ -84,7 +252,7 @@ int main(int argc, char** argv) {
 
     if (S_ISDIR(sb.st_mode)) { /* it's a directory */
         input_dir = true;
-        dirfd = opendir(argv[1]);
+        dirfd = opendir(path);
     }
 
     /* --------------------------------------------- */
@@ -97,7 +265,7 @@ int main(int argc, char** argv) {
         char dirname[PATH_MAX + 1] = {0};
 
         /* in case it's . or .. or whatever */
-        realpath(argv[1], dirname);
+        realpath(path, dirname);
 
         /* could have trailing /, or not */
         if (*(dirname + strlen(dirname) - 1) == '/') {
@@ -122,13 +290,21 @@ int main(int argc, char** argv) {
         strcat(ofname, OUT_EXT);
     } else {
         /* one byte for '.', one for NUL */
-        ofname = calloc(strlen(argv[1]) + strlen(OUT_EXT) + 2, sizeof(*ofname));
-        strcpy(ofname, argv[1]);
+        ofname = calloc(strlen(path) + strlen(OUT_EXT) + 2, sizeof(*ofname));
+        strcpy(ofname, path);
         strcpy(strrchr(ofname, '.') + 1,
                OUT_EXT); /* overwrite file extension */
     }
 
-    wtr = writer_alloc(ofname);
+    unsigned mode = M_DEFAULT;
+    if (optimize) {
+        mode |= M_IN_PLACE | M_CACHE_TOS;
+    }
+    if (shared) {
+        mode |= M_SHARED_CALLS | M_SHARED_COMPARE;
+    }
+
+    wtr = writer_alloc(ofname, mode);
 
     free(ofname);
     ofname = NULL;
@@ -139,16 +315,22 @@ int main(int argc, char** argv) {
         goto EXIT;
     }
 
-    /* --------------------------- */
-    /* Parse the File Line-by-Line */
-    /* --------------------------- */
+    /* --------------------------------- */
+    /* Parse Every File into One Program */
+    /* --------------------------------- */
 
     struct dirent* next_file = NULL;
     char* next_file_name = NULL;
 
+    ir = ir_alloc();
+    if (!ir) {
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
     /* if only doing a single file, jump into the loop */
     if (!input_dir) {
-        next_file_name = argv[1];
+        next_file_name = path;
         goto PARSE_FILE;
     }
 
@@ -169,90 +351,35 @@ int main(int argc, char** argv) {
             continue;
         }
 
-        /* tell the writer that we're parsing a different file now */
-        writer_set_fname(wtr, next_file_name);
-
-        /* begin parsing */
-        parser_free(psr);
-        psr = NULL;
-        psr = parser_alloc(next_file_name);
-        if (!psr) {
-            fprintf(stderr, "[ERROR] Could not create Parser\n");
+        /* read the whole file in, code is generated once all of them are */
+        if (!ir_add_file(ir, next_file_name)) {
             EXIT_STATUS = EXIT_FAILURE;
             goto EXIT;
         }
+    }
 
-        while (parser_has_lines(psr)) {
-            parser_advance(psr);
-            enum cmd_t cmd = parser_command_type(psr);
+    /* ------------------------------- */
+    /* Generate Code for Every Command */
+    /* ------------------------------- */
 
-            switch (cmd) {
-            case C_ARITHMETIC:
-                if (!writer_put_al(wtr, parser_arg1(psr).operation)) {
-                    fprintf(
-                        stderr,
-                        "[ERROR] Could not write arithmetic-logical command\n");
-                    EXIT_STATUS = EXIT_FAILURE;
-                    goto EXIT;
-                }
-                break;
-            case C_PUSH:
-            case C_POP:
-                if (!writer_put_so(wtr, cmd, parser_arg1(psr).segment,
-                                   parser_arg2(psr))) {
-                    fprintf(
-                        stderr,
-                        "[ERROR] Could not write arithmetic-logical command\n");
-                    EXIT_STATUS = EXIT_FAILURE;
-                    goto EXIT;
-                }
-                break;
-            case C_LABEL:
-            case C_GOTO:
-            case C_IF:
-                if (!writer_put_branch(wtr, cmd, parser_arg1(psr).label)) {
-                    fprintf(stderr,
-                            "[ERROR] Could not write branching command\n");
-                    EXIT_STATUS = EXIT_FAILURE;
-                    goto EXIT;
-                }
-                break;
-            case C_FUNCTION:
-                if (!writer_put_func(wtr, parser_arg1(psr).label,
-                                     parser_arg2(psr))) {
-                    fprintf(stderr,
-                            "[ERROR] Could not write function command\n");
-                    EXIT_STATUS = EXIT_FAILURE;
-                    goto EXIT;
-                }
-                break;
-            case C_RETURN:
-                if (!writer_put_return(wtr)) {
-                    fprintf(stderr, "[ERROR] Could not write return command\n");
-                    EXIT_STATUS = EXIT_FAILURE;
-                    goto EXIT;
-                }
-                break;
-            case C_CALL:
-                if (!writer_put_call(wtr, parser_arg1(psr).label,
-                                     parser_arg2(psr))) {
-                    fprintf(stderr, "[ERROR] Could not write call command\n");
-                    EXIT_STATUS = EXIT_FAILURE;
-                    goto EXIT;
-                }
-                break;
-            default:
-                fprintf(stderr, "[ERROR] I wasn't expecting that command type "
-                                "just yet :/\n");
-                EXIT_STATUS = EXIT_FAILURE;
-                goto EXIT;
-            }
-        }
+    if (optimize) {
+        optimize_fold(ir);
+    }
+
+    if (!translate(ir, wtr, optimize) || !writer_put_shared(wtr)) {
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
+    }
+
+    if (!writer_flush(wtr)) {
+        fprintf(stderr, "[ERROR] Could not write output file\n");
+        EXIT_STATUS = EXIT_FAILURE;
+        goto EXIT;
     }
 
 EXIT:
     writer_free(wtr);
-    parser_free(psr);
+    ir_free(ir);
 
     free(rel_path_prefix);
     if (input_dir) {
@@ -11,11 +11,12 @@
 
 /* standard library headers */
 #define _POSIX_C_SOURCE 200809L
-#include <stddef.h> /* for NULL, size_t */
-#include <stdint.h> /* for int16_t */
-#include <stdio.h>  /* for FILE, fopen, perror, fclose, fprintf, stderr*/
-#include <stdlib.h> /* for malloc, free */
-#include <string.h> /* for strlen, strcpy, strrchr, strtok */
+#include <stdbool.h> /* for bool, true, false */
+#include <stddef.h>  /* for NULL, size_t */
+#include <stdint.h>  /* for int16_t, uint32_t, INT16_MIN */
+#include <stdio.h>   /* for FILE, fopen, perror, fclose, fwrite, stderr */
+#include <stdlib.h>  /* for malloc, free */
+#include <string.h>  /* for strlen, strcpy, strrchr, strtok, memcpy */
 
 /* project-specific modules */
 #include "parser.h" /* for cmd_t, C_PUSH, C_POP */
@@ -25,45 +26,168 @@
 /* Types and Constants */
 /* <<<<<<<<<<<<<<<<<<< */
 
+/* bytes of output collected before they're written to the file */
+#define WRITER_BUF_LEN (1 << 16)
+
 struct writer {
     FILE* fout;
     char* fname;
     char* curr_func;
     size_t label_count;
+    unsigned mode; /* see mode_t */
+    bool cached;   /* M_CACHE_TOS: the top of the stack is in D, not in RAM */
+
+    /* M_SHARED_CALLS: which shared routines the program has used so far */
+    uint32_t used_calls; /* bit n for CALL_ROUTINE.n */
+    bool used_call, used_return;
+
+    /* M_SHARED_COMPARE: bit op for each comparison that has been used */
+    unsigned used_compares;
+
+    /* output goes out a block at a time, rather than a command at a time */
+    char buf[WRITER_BUF_LEN];
+    size_t len;
+    bool failed; /* some output could not be written */
 };
 
 static const char* const default_func = "GLOBAL";
 
+/* M_SHARED_CALLS: names of the shared routines, which can't clash with any
+ * function or label in the VM code: VM names can't contain a '$', and the
+ * labels made from them only ever have one after the function name */
+static const char* const CALL_ROUTINE = "$call";
+static const char* const FRAME_ROUTINE = "$call.frame";
+static const char* const RETURN_ROUTINE = "$return";
+static const char* const HALT_ROUTINE = "$halt";
+
+/* M_SHARED_COMPARE: names of the shared comparison routines, by op-code,
+ * free for the same reason */
+static const char* const COMPARE_ROUTINES[] = {
+    [O_EQ] = "$eq",
+    [O_GT] = "$gt",
+    [O_LT] = "$lt",
+};
+
+/* M_SHARED_CALLS: calls with fewer arguments than this get an entry point of
+ * their own into the shared routine, and so shorter call sites */
+static const int16_t NUM_CALL_ENTRIES = 32;
+
+/* M_CACHE_TOS: segment entries up to this index are reached by stepping A
+ * from the base, beyond it adding the index through R13 is shorter */
+static const int16_t MAX_STEPS = 9;
+
 /* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
 /* (Private) Subroutine Definitions */
 /* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
 
+static void flush(struct writer* const wtr) {
+    if (wtr->len && fwrite(wtr->buf, 1, wtr->len, wtr->fout) != wtr->len) {
+        wtr->failed = true;
+    }
+
+    wtr->len = 0;
+}
+
+static void put_mem(struct writer* const wtr, const char* const str,
+                    const size_t len) {
+    if (wtr->len + len > WRITER_BUF_LEN) {
+        flush(wtr);
+    }
+
+    /* too long to ever fit, so skip the buffer */
+    if (len > WRITER_BUF_LEN) {
+        if (fwrite(str, 1, len, wtr->fout) != len) {
+            wtr->failed = true;
+        }
+        return;
+    }
+
+    memcpy(wtr->buf + wtr->len, str, len);
+    wtr->len += len;
+}
+
+static void put_str(struct writer* const wtr, const char* const str) {
+    put_mem(wtr, str, strlen(str));
+}
+
+static void put_chr(struct writer* const wtr, const char c) {
+    put_mem(wtr, &c, 1);
+}
+
+static void put_num(struct writer* const wtr, size_t num) {
+    char digits[24];
+    size_t i = sizeof(digits);
+
+    do {
+        digits[--i] = (char)('0' + num % 10);
+        num /= 10;
+    } while (num);
+
+    put_mem(wtr, digits + i, sizeof(digits) - i);
+}
+
+/* a label generated for the current file: <file>:<n> */
+static void put_file_label(struct writer* const wtr, const char prefix,
+                           const size_t n, const char* const suffix) {
+    put_chr(wtr, prefix);
+    put_str(wtr, wtr->fname);
+    put_chr(wtr, ':');
+    put_num(wtr, n);
+    put_str(wtr, suffix);
+}
+
+/* a label within the current function: <function>$<label> */
+static void put_func_label(struct writer* const wtr, const char prefix,
+                           const char* const label, const char* const suffix) {
+    put_chr(wtr, prefix);
+    put_str(wtr, wtr->curr_func);
+    put_chr(wtr, '$');
+    put_str(wtr, label);
+    put_str(wtr, suffix);
+}
+
 static void pop_D(struct writer* const wtr) {
-    fprintf(wtr->fout, "@SP\nM=M-1\nA=M\nD=M\n");
+    put_str(wtr, "@SP\nM=M-1\nA=M\nD=M\n");
 }
 
 static void push_D(struct writer* const wtr) {
-    fprintf(wtr->fout, "@SP\nM=M+1\nA=M-1\nM=D\n");
+    put_str(wtr, "@SP\nM=M+1\nA=M-1\nM=D\n");
+}
+
+/* M_CACHE_TOS: puts a cached stack top back in RAM */
+static void spill(struct writer* const wtr) {
+    if (wtr->cached) {
+        push_D(wtr);
+        wtr->cached = false;
+    }
+}
+
+/* M_CACHE_TOS: brings the stack top into D, if it isn't there already */
+static void fill(struct writer* const wtr) {
+    if (!wtr->cached) {
+        put_str(wtr, "@SP\nAM=M-1\nD=M\n");
+        wtr->cached = true;
+    }
 }
 
 static void write_arithmetic(struct writer* const wtr, const enum op_t op) {
     pop_D(wtr);
-    fprintf(wtr->fout, "@R13\nM=D\n");
+    put_str(wtr, "@R13\nM=D\n");
     pop_D(wtr);
-    fprintf(wtr->fout, "@R13\n");
+    put_str(wtr, "@R13\n");
 
     switch (op) {
     case O_ADD:
-        fprintf(wtr->fout, "D=D+M\n");
+        put_str(wtr, "D=D+M\n");
         break;
     case O_SUB:
-        fprintf(wtr->fout, "D=D-M\n");
+        put_str(wtr, "D=D-M\n");
         break;
     case O_AND:
-        fprintf(wtr->fout, "D=D&M\n");
+        put_str(wtr, "D=D&M\n");
         break;
     case O_OR:
-        fprintf(wtr->fout, "D=D|M\n");
+        put_str(wtr, "D=D|M\n");
         break;
     default:
         fprintf(stderr,
@@ -76,37 +200,103 @@ static void write_arithmetic(struct writer* const wtr, const enum op_t op) {
 
 static void write_comparison(struct writer* const wtr, const enum op_t op) {
     pop_D(wtr);
-    fprintf(wtr->fout, "@R13\nM=D\n");
+    put_str(wtr, "@R13\nM=D\n");
+    pop_D(wtr);
+    put_str(wtr, "@R13\nD=D-M\n");
+
+    /* one label for true, one for after */
+    const size_t label = wtr->label_count;
+    wtr->label_count += 2;
+
+    put_file_label(wtr, '@', label, "\n");
+
+    switch (op) {
+    case O_EQ:
+        put_str(wtr, "D;JEQ\n");
+        break;
+    case O_LT:
+        put_str(wtr, "D;JLT\n");
+        break;
+    case O_GT:
+        put_str(wtr, "D;JGT\n");
+        break;
+    default:
+        fprintf(stderr,
+                "[WARNING] Calling %s with incompatible op-code, no operation "
+                "performed\n",
+                __func__);
+        return;
+    }
+
+    put_str(wtr, "D=0\n");
+    put_file_label(wtr, '@', label + 1, "\n0;JMP\n");
+    put_file_label(wtr, '(', label, ")\nD=-1\n");
+    put_file_label(wtr, '(', label + 1, ")\n");
+}
+
+static void write_unary(struct writer* const wtr, const enum op_t op) {
     pop_D(wtr);
-    fprintf(wtr->fout, "@R13\nD=D-M\n");
 
-    /* stupid labels ugh kill meeeeeeee */
-    const int len = snprintf(NULL, 0, "%zu", wtr->label_count + 1);
-    char* label_1_load =
-        calloc(strlen(wtr->fname) + len + 4, sizeof(*label_1_load));
-    char* label_2_load =
-        calloc(strlen(wtr->fname) + len + 4, sizeof(*label_1_load));
+    switch (op) {
+    case O_NEG:
+        put_str(wtr, "D=-D\n");
+        break;
+    case O_NOT:
+        put_str(wtr, "D=!D\n");
+        break;
+    default:
+        fprintf(stderr,
+                "[WARNING] Calling %s with incompatible op-code, no operation "
+                "performed\n",
+                __func__);
+        return;
+    }
+}
 
-    char* label_1 = calloc(strlen(wtr->fname) + len + 5, sizeof(*label_1));
-    char* label_2 = calloc(strlen(wtr->fname) + len + 5, sizeof(*label_1));
+/* x op y, with x overwritten by the result */
+static void write_arithmetic_in_place(struct writer* const wtr,
+                                      const enum op_t op) {
+    put_str(wtr, "@SP\nAM=M-1\nD=M\nA=A-1\n");
 
-    sprintf(label_1_load, "@%s:%zu\n", wtr->fname, wtr->label_count);
-    sprintf(label_1, "(%s:%zu)\n", wtr->fname, wtr->label_count++);
+    switch (op) {
+    case O_ADD:
+        put_str(wtr, "M=D+M\n");
+        break;
+    case O_SUB:
+        put_str(wtr, "M=M-D\n");
+        break;
+    case O_AND:
+        put_str(wtr, "M=D&M\n");
+        break;
+    case O_OR:
+        put_str(wtr, "M=D|M\n");
+        break;
+    default:
+        fprintf(stderr,
+                "[WARNING] Calling %s with incompatible op-code, no operation "
+                "performed\n",
+                __func__);
+        break;
+    }
+}
 
-    sprintf(label_2_load, "@%s:%zu\n", wtr->fname, wtr->label_count);
-    sprintf(label_2, "(%s:%zu)\n", wtr->fname, wtr->label_count++);
+/* x is overwritten with true, then with false if the jump isn't taken */
+static void write_comparison_in_place(struct writer* const wtr,
+                                      const enum op_t op) {
+    const size_t label = wtr->label_count++;
 
-    fprintf(wtr->fout, "%s", label_1_load);
+    put_str(wtr, "@SP\nAM=M-1\nD=M\nA=A-1\nD=M-D\nM=-1\n");
+    put_file_label(wtr, '@', label, "\n");
 
     switch (op) {
     case O_EQ:
-        fprintf(wtr->fout, "D;JEQ\n");
+        put_str(wtr, "D;JEQ\n");
         break;
     case O_LT:
-        fprintf(wtr->fout, "D;JLT\n");
+        put_str(wtr, "D;JLT\n");
         break;
     case O_GT:
-        fprintf(wtr->fout, "D;JGT\n");
+        put_str(wtr, "D;JGT\n");
         break;
     default:
         fprintf(stderr,
@@ -116,28 +306,80 @@ static void write_comparison(struct writer* const wtr, const enum op_t op) {
         return;
     }
 
-    fprintf(wtr->fout, "D=0\n");
-    fprintf(wtr->fout, "%s", label_2_load);
-    fprintf(wtr->fout, "0;JMP\n");
-    fprintf(wtr->fout, "%s", label_1);
-    fprintf(wtr->fout, "D=-1\n");
-    fprintf(wtr->fout, "%s", label_2);
+    put_str(wtr, "@SP\nA=M-1\nM=0\n");
+    put_file_label(wtr, '(', label, ")\n");
+}
+
+/* M_SHARED_COMPARE: calls the shared routine for a comparison, with the
+ * return address in D (and y in R14, if it was cached) */
+static void write_comparison_call(struct writer* const wtr,
+                                  const enum op_t op) {
+    if (op != O_EQ && op != O_LT && op != O_GT) {
+        fprintf(stderr,
+                "[WARNING] Calling %s with incompatible op-code, no operation "
+                "performed\n",
+                __func__);
+        return;
+    }
+
+    const size_t label = wtr->label_count++;
+
+    /* the routine leaves the result where the operands came from */
+    if (wtr->mode & M_CACHE_TOS) {
+        fill(wtr);
+        put_str(wtr, "@R14\nM=D\n");
+    }
+
+    put_file_label(wtr, '@', label, "\nD=A\n@");
+    put_str(wtr, COMPARE_ROUTINES[op]);
+    put_str(wtr, "\n0;JMP\n");
+    put_file_label(wtr, '(', label, ")\n");
 
-    free(label_1);
-    free(label_2);
-    free(label_1_load);
-    free(label_2_load);
+    wtr->used_compares |= 1u << op;
 }
 
-static void write_unary(struct writer* const wtr, const enum op_t op) {
-    pop_D(wtr);
+/* M_SHARED_COMPARE: the shared routine for a comparison */
+static void write_comparison_routine(struct writer* const wtr,
+                                     const enum op_t op) {
+    const char* const name = COMPARE_ROUTINES[op];
+    const char* const jump =
+        (op == O_EQ ? "JEQ\n" : op == O_LT ? "JLT\n" : "JGT\n");
+
+    put_chr(wtr, '(');
+    put_str(wtr, name);
+    put_str(wtr, ")\n@R15\nM=D\n");
+
+    if (wtr->mode & M_CACHE_TOS) {
+        /* y is in R14, and the result goes back in D */
+        put_str(wtr, "@R14\nD=M\n@SP\nAM=M-1\nD=M-D\n@");
+        put_str(wtr, name);
+        put_str(wtr, ".true\nD;");
+        put_str(wtr, jump);
+        put_str(wtr, "D=0\n@R15\nA=M\n0;JMP\n(");
+        put_str(wtr, name);
+        put_str(wtr, ".true)\nD=-1\n@R15\nA=M\n0;JMP\n");
+    } else {
+        /* both operands are on the stack, and the result replaces them */
+        put_str(wtr, "@SP\nAM=M-1\nD=M\nA=A-1\nD=M-D\nM=-1\n@");
+        put_str(wtr, name);
+        put_str(wtr, ".true\nD;");
+        put_str(wtr, jump);
+        put_str(wtr, "@SP\nA=M-1\nM=0\n(");
+        put_str(wtr, name);
+        put_str(wtr, ".true)\n@R15\nA=M\n0;JMP\n");
+    }
+}
+
+static void write_unary_in_place(struct writer* const wtr,
+                                 const enum op_t op) {
+    put_str(wtr, "@SP\nA=M-1\n");
 
     switch (op) {
     case O_NEG:
-        fprintf(wtr->fout, "D=-D\n");
+        put_str(wtr, "M=-M\n");
         break;
     case O_NOT:
-        fprintf(wtr->fout, "D=!D\n");
+        put_str(wtr, "M=!M\n");
         break;
     default:
         fprintf(stderr,
@@ -148,22 +390,70 @@ static void write_unary(struct writer* const wtr, const enum op_t op) {
     }
 }
 
+/* x op y, with y cached in D and the result left there */
+static void write_cached(struct writer* const wtr, const enum op_t op) {
+    fill(wtr);
+
+    switch (op) {
+    case O_ADD:
+        put_str(wtr, "@SP\nAM=M-1\nD=D+M\n");
+        break;
+    case O_SUB:
+        put_str(wtr, "@SP\nAM=M-1\nD=M-D\n");
+        break;
+    case O_AND:
+        put_str(wtr, "@SP\nAM=M-1\nD=D&M\n");
+        break;
+    case O_OR:
+        put_str(wtr, "@SP\nAM=M-1\nD=D|M\n");
+        break;
+    case O_NEG:
+        put_str(wtr, "D=-D\n");
+        break;
+    case O_NOT:
+        put_str(wtr, "D=!D\n");
+        break;
+    case O_EQ:
+    case O_LT:
+    case O_GT: {
+        const size_t label = wtr->label_count;
+        wtr->label_count += 2;
+
+        put_str(wtr, "@SP\nAM=M-1\nD=M-D\n");
+        put_file_label(wtr, '@', label, "\n");
+        put_str(wtr, (op == O_EQ ? "D;JEQ\n" : op == O_LT ? "D;JLT\n"
+                                                          : "D;JGT\n"));
+        put_str(wtr, "D=0\n");
+        put_file_label(wtr, '@', label + 1, "\n0;JMP\n");
+        put_file_label(wtr, '(', label, ")\nD=-1\n");
+        put_file_label(wtr, '(', label + 1, ")\n");
+        break;
+    }
+    default:
+        fprintf(stderr,
+                "[WARNING] Calling %s with incompatible op-code, no operation "
+                "performed\n",
+                __func__);
+        break;
+    }
+}
+
 static void access_segment(struct writer* const wtr, const enum seg_t seg) {
     switch (seg) {
     case S_LOCAL:
-        fprintf(wtr->fout, "@LCL\n");
+        put_str(wtr, "@LCL\n");
         break;
     case S_ARGUMENT:
-        fprintf(wtr->fout, "@ARG\n");
+        put_str(wtr, "@ARG\n");
         break;
     case S_THIS:
-        fprintf(wtr->fout, "@THIS\n");
+        put_str(wtr, "@THIS\n");
         break;
     case S_THAT:
-        fprintf(wtr->fout, "@THAT\n");
+        put_str(wtr, "@THAT\n");
         break;
     case S_TEMP:
-        fprintf(wtr->fout, "@5\n");
+        put_str(wtr, "@5\n");
         break;
     case S_CONSTANT:
         /* we never literally access the purely virtual constant segment */
@@ -176,7 +466,11 @@ static void access_segment(struct writer* const wtr, const enum seg_t seg) {
 }
 
 static void access_static(struct writer* const wtr, const int16_t idx) {
-    fprintf(wtr->fout, "@%s.%d\n", wtr->fname, idx);
+    put_chr(wtr, '@');
+    put_str(wtr, wtr->fname);
+    put_chr(wtr, '.');
+    put_num(wtr, (size_t)idx);
+    put_chr(wtr, '\n');
 }
 
 static void push_pointer(struct writer* const wtr, const enum seg_t seg,
@@ -184,7 +478,7 @@ static void push_pointer(struct writer* const wtr, const enum seg_t seg,
     switch (seg) {
     case S_POINTER:
         /* offset is 0 for pointer segment */
-        fprintf(wtr->fout, "@0\nD=A\n");
+        put_str(wtr, "@0\nD=A\n");
 
         switch (idx) {
         case 0:
@@ -195,7 +489,9 @@ static void push_pointer(struct writer* const wtr, const enum seg_t seg,
         }
         break;
     default:
-        fprintf(wtr->fout, "@%d\nD=A\n", idx);
+        put_chr(wtr, '@');
+        put_num(wtr, (size_t)idx);
+        put_str(wtr, "\nD=A\n");
         access_segment(wtr, seg);
     }
 
@@ -205,18 +501,18 @@ static void push_pointer(struct writer* const wtr, const enum seg_t seg,
     }
 
     if (seg == S_TEMP || seg == S_POINTER) {
-        fprintf(wtr->fout, "A=D+A\n");
+        put_str(wtr, "A=D+A\n");
     } else {
-        fprintf(wtr->fout, "A=D+M\n");
+        put_str(wtr, "A=D+M\n");
     }
 
-    fprintf(wtr->fout, "D=M\n");
+    put_str(wtr, "D=M\n");
 }
 
 static void push_static(struct writer* const wtr, const int16_t idx) {
     access_static(wtr, idx);
 
-    fprintf(wtr->fout, "D=M\n");
+    put_str(wtr, "D=M\n");
 }
 
 static void push(struct writer* const wtr, const enum seg_t seg,
@@ -245,12 +541,12 @@ static void push(struct writer* const wtr, const enum seg_t seg,
 
 static void pop_pointer(struct writer* const wtr, const enum seg_t seg,
                         const int16_t idx) {
-    fprintf(wtr->fout, "@R14\nM=D\n");
+    put_str(wtr, "@R14\nM=D\n");
 
     switch (seg) {
     case S_POINTER:
         /* offset is 0 for pointer segment */
-        fprintf(wtr->fout, "@0\nD=A\n");
+        put_str(wtr, "@0\nD=A\n");
 
         switch (idx) {
         case 0:
@@ -261,23 +557,126 @@ static void pop_pointer(struct writer* const wtr, const enum seg_t seg,
         }
         break;
     default:
-        fprintf(wtr->fout, "@%d\nD=A\n", idx);
+        put_chr(wtr, '@');
+        put_num(wtr, (size_t)idx);
+        put_str(wtr, "\nD=A\n");
         access_segment(wtr, seg);
     }
 
     if (seg == S_TEMP || seg == S_POINTER) {
-        fprintf(wtr->fout, "D=D+A\n");
+        put_str(wtr, "D=D+A\n");
     } else {
-        fprintf(wtr->fout, "D=D+M\n");
+        put_str(wtr, "D=D+M\n");
     }
 
-    fprintf(wtr->fout, "@R15\nM=D\n@R14\nD=M\n@R15\nA=M\nM=D\n");
+    put_str(wtr, "@R15\nM=D\n@R14\nD=M\n@R15\nA=M\nM=D\n");
 }
 
 static void pop_static(struct writer* const wtr, const int16_t idx) {
     access_static(wtr, idx);
 
-    fprintf(wtr->fout, "M=D\n");
+    put_str(wtr, "M=D\n");
+}
+
+/* M_CACHE_TOS: points A at a segment entry, touching nothing else in RAM;
+ * false if that would take more than MAX_STEPS */
+static bool address_direct(struct writer* const wtr, const enum seg_t seg,
+                           const int16_t idx) {
+    switch (seg) {
+    case S_TEMP:
+        put_chr(wtr, '@');
+        put_num(wtr, (size_t)(5 + idx));
+        put_chr(wtr, '\n');
+        return true;
+    case S_POINTER:
+        put_str(wtr, (idx ? "@THAT\n" : "@THIS\n"));
+        return true;
+    case S_STATIC:
+        access_static(wtr, idx);
+        return true;
+    case S_LOCAL:
+    case S_ARGUMENT:
+    case S_THIS:
+    case S_THAT:
+        if (idx > MAX_STEPS) {
+            return false;
+        }
+        access_segment(wtr, seg);
+        put_str(wtr, "A=M\n");
+        for (int16_t i = 0; i < idx; ++i) {
+            put_str(wtr, "A=A+1\n");
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* M_CACHE_TOS: pushes by loading straight into D, which becomes the cache */
+static void push_cached(struct writer* const wtr, const enum seg_t seg,
+                        const int16_t idx) {
+    spill(wtr);
+
+    if (seg == S_CONSTANT) {
+        put_chr(wtr, '@');
+        put_num(wtr, (size_t)idx);
+        put_str(wtr, "\nD=A\n");
+    } else if (address_direct(wtr, seg, idx)) {
+        put_str(wtr, "D=M\n");
+    } else {
+        push_pointer(wtr, seg, idx);
+    }
+
+    wtr->cached = true;
+}
+
+/* M_CACHE_TOS: pops by storing straight from D */
+static void pop_cached(struct writer* const wtr, const enum seg_t seg,
+                       const int16_t idx) {
+    fill(wtr);
+    wtr->cached = false;
+
+    if (address_direct(wtr, seg, idx)) {
+        put_str(wtr, "M=D\n");
+    } else {
+        pop_pointer(wtr, seg, idx);
+    }
+}
+
+/* the rest of a return, once the return value is in D */
+static void write_return(struct writer* const wtr) {
+    put_str(wtr, "@ARG\nA=M\nM=D\n");
+
+    /* reposition SP for the caller */
+    put_str(wtr, "@ARG\nD=M+1\n@SP\nM=D\n");
+
+    /* restore segment pointers from stack frame */
+    put_str(wtr, "@LCL\nD=M\n@R13\nM=D-1\nA=M\nD=M\n@THAT\nM=D\n");
+    put_str(wtr, "@R13\nM=M-1\nA=M\nD=M\n@THIS\nM=D\n");
+    put_str(wtr, "@R13\nM=M-1\nA=M\nD=M\n@ARG\nM=D\n");
+    put_str(wtr, "@R13\nM=M-1\nA=M\nD=M\n@LCL\nM=D\n");
+
+    /* go to the return address */
+    put_str(wtr, "@R13\nM=M-1\nA=M\nA=M\n0;JMP\n");
+}
+
+/* saves the caller's segment pointers, once the return address has been
+ * pushed, repositions ARG (to SP - R14) and LCL, and jumps to the callee (in
+ * R13) */
+static void write_frame(struct writer* const wtr) {
+    put_str(wtr, "@LCL\nD=M\n");
+    push_D(wtr);
+    put_str(wtr, "@ARG\nD=M\n");
+    push_D(wtr);
+    put_str(wtr, "@THIS\nD=M\n");
+    push_D(wtr);
+    put_str(wtr, "@THAT\nD=M\n");
+    push_D(wtr);
+
+    put_str(wtr, "@R14\nD=M\n@SP\nD=M-D\n@ARG\nM=D\n");
+    put_str(wtr, "@SP\nD=M\n@LCL\nM=D\n");
+
+    put_str(wtr, "@R13\nA=M\n0;JMP\n");
 }
 
 static void pop(struct writer* const wtr, const enum seg_t seg,
@@ -307,7 +706,7 @@ static void pop(struct writer* const wtr, const enum seg_t seg,
 /* (Public) Subroutine Definitions */
 /* <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
 
-struct writer* writer_alloc(const char* const fpath) {
+struct writer* writer_alloc(const char* const fpath, const unsigned mode) {
     if (!fpath) {
         return NULL;
     }
@@ -331,7 +730,14 @@ struct writer* writer_alloc(const char* const fpath) {
 
     wtr->fout = fout;
     wtr->label_count = 0;
+    wtr->mode = mode;
+    wtr->cached = false;
+    wtr->used_calls = 0;
+    wtr->used_call = wtr->used_return = false;
+    wtr->used_compares = 0;
     wtr->fname = NULL;
+    wtr->len = 0;
+    wtr->failed = false;
 
     /* set default function name */
     wtr->curr_func = calloc(strlen(default_func) + 1, sizeof(*wtr->curr_func));
@@ -341,9 +747,15 @@ struct writer* writer_alloc(const char* const fpath) {
     /* Bootstrap Code */
     /* -------------- */
 
-    fprintf(wtr->fout, "@256\nD=A\n@SP\nM=D\n");
+    /* the call is only made once, and programs with no calls of their own
+     * shouldn't need the shared routines */
+    wtr->mode = mode & ~(unsigned)M_SHARED_CALLS;
+
+    put_str(wtr, "@256\nD=A\n@SP\nM=D\n");
     writer_put_call(wtr, "Sys.init", 0);
 
+    wtr->mode = mode;
+
     return wtr;
 }
 
@@ -352,7 +764,10 @@ void writer_free(struct writer* const wtr) {
         return;
     }
 
-    /* attempt to close the file if it's open */
+    /* attempt to close the file if it's open, after the last of the output */
+    if (wtr->fout) {
+        flush(wtr);
+    }
     if (wtr->fout && fclose(wtr->fout)) {
         perror("[ERROR] fclose");
         wtr->fout = NULL;
@@ -367,7 +782,29 @@ void writer_free(struct writer* const wtr) {
     free(wtr);
 }
 
+bool writer_flush(struct writer* const wtr) {
+    if (!wtr || !wtr->fout) {
+        fprintf(stderr,
+                "[WARNING] Calling %s with NULL argument(s), no operation "
+                "performed\n",
+                __func__);
+        return false;
+    }
+
+    /* the program may end with the stack top still in D */
+    spill(wtr);
+
+    flush(wtr);
+    if (fflush(wtr->fout)) {
+        wtr->failed = true;
+    }
+
+    return !wtr->failed;
+}
+
 void writer_set_fname(struct writer* const wtr, const char* const fpath) {
+    spill(wtr);
+
     /* extract filename from path */
     char* fpath_cpy = calloc(strlen(fpath) + 1, sizeof(*fpath_cpy));
     strcpy(fpath_cpy, fpath);
@@ -402,6 +839,44 @@ bool writer_put_al(struct writer* const wtr, const enum op_t op) {
         return false;
     }
 
+    if ((wtr->mode & M_SHARED_COMPARE) &&
+        (op == O_EQ || op == O_LT || op == O_GT)) {
+        write_comparison_call(wtr, op);
+        return true;
+    }
+
+    if (wtr->mode & M_CACHE_TOS) {
+        write_cached(wtr, op);
+        return true;
+    }
+
+    /* the result is already on the stack, nothing to push */
+    if (wtr->mode & M_IN_PLACE) {
+        switch (op) {
+        case O_ADD:
+        case O_SUB:
+        case O_AND:
+        case O_OR:
+            write_arithmetic_in_place(wtr, op);
+            return true;
+        case O_EQ:
+        case O_LT:
+        case O_GT:
+            write_comparison_in_place(wtr, op);
+            return true;
+        case O_NEG:
+        case O_NOT:
+            write_unary_in_place(wtr, op);
+            return true;
+        default:
+            fprintf(stderr,
+                    "[WARNING] Calling %s with incompatible op-code, no "
+                    "operation performed\n",
+                    __func__);
+            return false;
+        }
+    }
+
     switch (op) {
     case O_ADD:
     case O_SUB:
@@ -458,6 +933,22 @@ bool writer_put_so(struct writer* const wtr, const enum cmd_t cmd_type,
         return false;
     }
 
+    if (wtr->mode & M_CACHE_TOS) {
+        if (seg == S_ERROR || (cmd_type == C_POP && seg == S_CONSTANT)) {
+            fprintf(stderr,
+                    "[WARNING] Calling %s with error-type memory segment\n",
+                    __func__);
+            return false;
+        }
+
+        if (cmd_type == C_PUSH) {
+            push_cached(wtr, seg, idx);
+        } else {
+            pop_cached(wtr, seg, idx);
+        }
+        return true;
+    }
+
     switch (cmd_type) {
     case C_PUSH:
         push(wtr, seg, idx);
@@ -476,6 +967,38 @@ bool writer_put_so(struct writer* const wtr, const enum cmd_t cmd_type,
     return true;
 }
 
+bool writer_put_const(struct writer* const wtr, const int16_t val) {
+    if (!wtr || !wtr->fout) {
+        fprintf(stderr,
+                "[WARNING] Calling %s with NULL argument(s), no operation "
+                "performed\n",
+                __func__);
+        return false;
+    }
+
+    spill(wtr);
+
+    /* A-instructions only load 15 bits, negative values need computing */
+    put_chr(wtr, '@');
+    if (val >= 0) {
+        put_num(wtr, (size_t)val);
+        put_str(wtr, "\nD=A\n");
+    } else if (val == INT16_MIN) {
+        put_str(wtr, "32767\nD=!A\n");
+    } else {
+        put_num(wtr, (size_t)-val);
+        put_str(wtr, "\nD=-A\n");
+    }
+
+    if (wtr->mode & M_CACHE_TOS) {
+        wtr->cached = true;
+    } else {
+        push_D(wtr);
+    }
+
+    return true;
+}
+
 bool writer_put_branch(struct writer* const wtr, const enum cmd_t cmd_type,
                        const char* const label) {
     if (!wtr || !wtr->fout) {
@@ -486,16 +1009,25 @@ bool writer_put_branch(struct writer* const wtr, const enum cmd_t cmd_type,
         return false;
     }
 
+    /* code can come in from anywhere at a label, and the code after a jump
+     * has to agree with it about where the stack top is */
     switch (cmd_type) {
     case C_LABEL:
-        fprintf(wtr->fout, "(%s$%s)\n", wtr->curr_func, label);
+        spill(wtr);
+        put_func_label(wtr, '(', label, ")\n");
         break;
     case C_GOTO:
-        fprintf(wtr->fout, "@%s$%s\n0;JMP\n", wtr->curr_func, label);
+        spill(wtr);
+        put_func_label(wtr, '@', label, "\n0;JMP\n");
         break;
     case C_IF:
-        pop_D(wtr);
-        fprintf(wtr->fout, "@%s$%s\nD;JNE\n", wtr->curr_func, label);
+        if (wtr->mode & M_CACHE_TOS) {
+            fill(wtr);
+            wtr->cached = false;
+        } else {
+            pop_D(wtr);
+        }
+        put_func_label(wtr, '@', label, "\nD;JNE\n");
         break;
     default:
         fprintf(
@@ -508,6 +1040,71 @@ bool writer_put_branch(struct writer* const wtr, const enum cmd_t cmd_type,
     return true;
 }
 
+bool writer_put_cond(struct writer* const wtr, const enum op_t test,
+                     const bool negated, const char* const label) {
+    if (!wtr || !wtr->fout || !label) {
+        fprintf(stderr,
+                "[WARNING] Calling %s with NULL argument(s), no operation "
+                "performed\n",
+                __func__);
+        return false;
+    }
+
+    /* jump taken when the test is true, and when it is false */
+    const char* jumps[2];
+
+    switch (test) {
+    case O_EQ:
+        jumps[0] = "JEQ", jumps[1] = "JNE";
+        break;
+    case O_LT:
+        jumps[0] = "JLT", jumps[1] = "JGE";
+        break;
+    case O_GT:
+        jumps[0] = "JGT", jumps[1] = "JLE";
+        break;
+    case O_NOT:
+        /* not y is true for anything but -1, not only for 0 */
+        jumps[0] = "JNE", jumps[1] = NULL;
+        break;
+    default:
+        jumps[0] = jumps[1] = NULL;
+        break;
+    }
+
+    if (!jumps[negated]) {
+        fprintf(stderr,
+                "[WARNING] Calling %s with incompatible op-code, no operation "
+                "performed\n",
+                __func__);
+        return false;
+    }
+
+    /* get y + 1, or x - y for a comparison, into D, popping the operands */
+    if (wtr->mode & M_CACHE_TOS) {
+        fill(wtr);
+        wtr->cached = false;
+
+        if (test != O_NOT) {
+            put_str(wtr, "@SP\nAM=M-1\nD=M-D\n");
+        }
+    } else if (test != O_NOT) {
+        put_str(wtr, "@SP\nM=M-1\nAM=M-1\nD=M\nA=A+1\nD=D-M\n");
+    } else {
+        pop_D(wtr);
+    }
+
+    if (test == O_NOT) {
+        put_str(wtr, "D=D+1\n");
+    }
+
+    put_func_label(wtr, '@', label, "\nD;");
+    put_str(wtr, jumps[negated]);
+    put_chr(wtr, '\n');
+
+    return true;
+}
+
 bool writer_put_func(struct writer* const wtr, const char* const label,
                      const int16_t nvars) {
     if (!wtr || !wtr->fout) {
@@ -519,7 +1116,10 @@ bool writer_put_func(struct writer* const wtr, const char* const label,
     }
 
     /* inject function entry label into code */
-    fprintf(wtr->fout, "(%s)\n", label);
+    spill(wtr);
+    put_chr(wtr, '(');
+    put_str(wtr, label);
+    put_str(wtr, ")\n");
 
     /* initialize local variables */
     for (int16_t i = 0; i < nvars; ++i) {
@@ -544,20 +1144,21 @@ bool writer_put_return(struct writer* const wtr) {
     }
 
     /* reposition the return value for the caller */
-    pop_D(wtr);
-    fprintf(wtr->fout, "@ARG\nA=M\nM=D\n");
-
-    /* reposition SP for the caller */
-    fprintf(wtr->fout, "@ARG\nD=M+1\n@SP\nM=D\n");
-
-    /* restore segment pointers from stack frame */
-    fprintf(wtr->fout, "@LCL\nD=M\n@R13\nM=D-1\nA=M\nD=M\n@THAT\nM=D\n");
-    fprintf(wtr->fout, "@R13\nM=M-1\nA=M\nD=M\n@THIS\nM=D\n");
-    fprintf(wtr->fout, "@R13\nM=M-1\nA=M\nD=M\n@ARG\nM=D\n");
-    fprintf(wtr->fout, "@R13\nM=M-1\nA=M\nD=M\n@LCL\nM=D\n");
+    if (wtr->mode & M_CACHE_TOS) {
+        fill(wtr);
+        wtr->cached = false;
+    } else {
+        pop_D(wtr);
+    }
 
-    /* go to the return address */
-    fprintf(wtr->fout, "@R13\nM=M-1\nA=M\nA=M\n0;JMP\n");
+    if (wtr->mode & M_SHARED_CALLS) {
+        put_chr(wtr, '@');
+        put_str(wtr, RETURN_ROUTINE);
+        put_str(wtr, "\n0;JMP\n");
+        wtr->used_return = true;
+    } else {
+        write_return(wtr);
+    }
 
     return true;
 }
@@ -581,29 +1182,150 @@ bool writer_put_call(struct writer* const wtr, const char* const label,
         nargs_cpy = 1;
     }
 
-    /* generate a label and push it to the stack */
-    fprintf(wtr->fout, "@%s$ret.%zu\nD=A\n", wtr->curr_func, wtr->label_count);
-    push_D(wtr);
+    /* the callee finds its arguments in RAM */
+    spill(wtr);
 
-    /* save memory segment base pointers to stack frame */
-    fprintf(wtr->fout, "@LCL\nD=M\n");
-    push_D(wtr);
-    fprintf(wtr->fout, "@ARG\nD=M\n");
-    push_D(wtr);
-    fprintf(wtr->fout, "@THIS\nD=M\n");
-    push_D(wtr);
-    fprintf(wtr->fout, "@THAT\nD=M\n");
-    push_D(wtr);
+    /* generate a label and push it to the stack */
+    const size_t ret = wtr->label_count++;
+
+    if (wtr->mode & M_SHARED_CALLS) {
+        /* the callee goes in R13 and the return address in D, and the number
+         * of arguments is either implied by the entry point or goes in R14 */
+        put_chr(wtr, '@');
+        put_str(wtr, label);
+        put_str(wtr, "\nD=A\n@R13\nM=D\n");
+
+        if (nargs_cpy >= NUM_CALL_ENTRIES) {
+            put_chr(wtr, '@');
+            put_num(wtr, (size_t)(5 + nargs_cpy));
+            put_str(wtr, "\nD=A\n@R14\nM=D\n");
+        }
 
-    /* reposition ARG and LCL */
-    fprintf(wtr->fout, "@%d\nD=A\n@SP\nD=M-D\n@ARG\nM=D\n", 5 + nargs_cpy);
-    fprintf(wtr->fout, "@SP\nD=M\n@LCL\nM=D\n");
+        put_func_label(wtr, '@', "ret.", "");
+        put_num(wtr, ret);
+        put_str(wtr, "\nD=A\n@");
+        put_str(wtr, CALL_ROUTINE);
+
+        if (nargs_cpy < NUM_CALL_ENTRIES) {
+            put_chr(wtr, '.');
+            put_num(wtr, (size_t)nargs_cpy);
+            wtr->used_calls |= (uint32_t)1 << nargs_cpy;
+        } else {
+            wtr->used_call = true;
+        }
 
-    /* transfer control to the callee */
-    fprintf(wtr->fout, "@%s\n0;JMP\n", label);
+        put_str(wtr, "\n0;JMP\n");
+    } else {
+        put_func_label(wtr, '@', "ret.", "");
+        put_num(wtr, ret);
+        put_str(wtr, "\nD=A\n");
+        push_D(wtr);
+
+        /* save memory segment base pointers to stack frame */
+        put_str(wtr, "@LCL\nD=M\n");
+        push_D(wtr);
+        put_str(wtr, "@ARG\nD=M\n");
+        push_D(wtr);
+        put_str(wtr, "@THIS\nD=M\n");
+        push_D(wtr);
+        put_str(wtr, "@THAT\nD=M\n");
+        push_D(wtr);
+
+        /* reposition ARG and LCL */
+        put_chr(wtr, '@');
+        put_num(wtr, (size_t)(5 + nargs_cpy));
+        put_str(wtr, "\nD=A\n@SP\nD=M-D\n@ARG\nM=D\n");
+        put_str(wtr, "@SP\nD=M\n@LCL\nM=D\n");
+
+        /* transfer control to the callee */
+        put_chr(wtr, '@');
+        put_str(wtr, label);
+        put_str(wtr, "\n0;JMP\n");
+    }
 
     /* inject the return address label into the code */
-    fprintf(wtr->fout, "(%s$ret.%zu)\n", wtr->curr_func, wtr->label_count++);
+    put_func_label(wtr, '(', "ret.", "");
+    put_num(wtr, ret);
+    put_str(wtr, ")\n");
+
+    return true;
+}
+
+bool writer_put_shared(struct writer* const wtr) {
+    if (!wtr || !wtr->fout) {
+        fprintf(stderr,
+                "[WARNING] Calling %s with NULL argument(s), no operation "
+                "performed\n",
+                __func__);
+        return false;
+    }
+
+    spill(wtr);
+
+    if (!wtr->used_calls && !wtr->used_call && !wtr->used_return &&
+        !wtr->used_compares) {
+        return true;
+    }
+
+    /* a program that runs off its end stops there, rather than running into
+     * the routines */
+    put_chr(wtr, '(');
+    put_str(wtr, HALT_ROUTINE);
+    put_str(wtr, ")\n@");
+    put_str(wtr, HALT_ROUTINE);
+    put_str(wtr, "\n0;JMP\n");
+
+    /* one entry point per number of arguments, which it puts in R14 */
+    for (int16_t n = 0; n < NUM_CALL_ENTRIES; ++n) {
+        if (!(wtr->used_calls & ((uint32_t)1 << n))) {
+            continue;
+        }
+
+        put_chr(wtr, '(');
+        put_str(wtr, CALL_ROUTINE);
+        put_chr(wtr, '.');
+        put_num(wtr, (size_t)n);
+        put_str(wtr, ")\n");
+
+        push_D(wtr);
+        put_chr(wtr, '@');
+        put_num(wtr, (size_t)(5 + n));
+        put_str(wtr, "\nD=A\n@R14\nM=D\n@");
+        put_str(wtr, FRAME_ROUTINE);
+        put_str(wtr, "\n0;JMP\n");
+    }
+
+    /* for calls that have already put the number of arguments in R14 */
+    if (wtr->used_call) {
+        put_chr(wtr, '(');
+        put_str(wtr, CALL_ROUTINE);
+        put_str(wtr, ")\n");
+        push_D(wtr);
+    }
+
+    if (wtr->used_calls || wtr->used_call) {
+        put_chr(wtr, '(');
+        put_str(wtr, FRAME_ROUTINE);
+        put_str(wtr, ")\n");
+        write_frame(wtr);
+    }
+
+    if (wtr->used_return) {
+        put_chr(wtr, '(');
+        put_str(wtr, RETURN_ROUTINE);
+        put_str(wtr, ")\n");
+        write_return(wtr);
+    }
+
+    const enum op_t compares[] = {O_EQ, O_LT, O_GT};
+    for (size_t i = 0; i < sizeof(compares) / sizeof(*compares); ++i) {
+        if (wtr->used_compares & (1u << compares[i])) {
+            write_comparison_routine(wtr, compares[i]);
+        }
+    }
+
+    wtr->used_calls = wtr->used_compares = 0;
+    wtr->used_call = wtr->used_return = false;
 
     return true;
 }